@@ -0,0 +1,134 @@
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "arena.h"
+
+#define ARENA_ALIGN		16
+#define ARENA_MIN_BLOCK		(64 * 1024)
+#define ARENA_ROUND(__size)	(((__size) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+
+struct arena_block {
+	struct arena_block *next;
+	size_t size;		/* Usable bytes past the header */
+	size_t used;
+};
+
+#define ARENA_HEADER		ARENA_ROUND(sizeof(struct arena_block))
+
+static struct arena_block *arena_grow(struct board_arena *arena, size_t size);
+
+void arena_init(struct board_arena *arena)
+{
+	arena->first = NULL;
+	arena->current = NULL;
+	arena->last = NULL;
+}
+
+void arena_destroy(struct board_arena *arena)
+{
+	struct arena_block *block;
+	struct arena_block *next;
+
+	for (block = arena->first; block; block = next) {
+		next = block->next;
+		free(block);
+	}
+
+	arena_init(arena);
+}
+
+/* Returns NULL only if the system allocator does. Memory is aligned for any
+ * of the types the solver keeps in it.
+ * */
+void *arena_alloc(struct board_arena *arena, size_t size)
+{
+	struct arena_block *block = arena->current;
+	void *ptr;
+
+	if (size > SIZE_MAX / 2)
+		return NULL;
+
+	size = ARENA_ROUND(size);
+
+	/* Blocks past the current one are free, whatever their used says.
+	 * Those too small for this allocation are passed over until the next
+	 * reset.
+	 * */
+	while (block && block->size - block->used < size) {
+		block = block->next;
+
+		if (block)
+			block->used = 0;
+	}
+
+	if (!block && !(block = arena_grow(arena, size)))
+		return NULL;
+
+	arena->current = block;
+	ptr = (char *)block + ARENA_HEADER + block->used;
+	block->used += size;
+
+	return ptr;
+}
+
+void arena_reset(struct board_arena *arena)
+{
+	arena->current = arena->first;
+
+	if (arena->current)
+		arena->current->used = 0;
+}
+
+struct arena_mark arena_save(const struct board_arena *arena)
+{
+	struct arena_mark mark;
+
+	mark.block = arena->current;
+	mark.used = arena->current ? arena->current->used : 0;
+
+	return mark;
+}
+
+void arena_restore(struct board_arena *arena, struct arena_mark mark)
+{
+	if (!mark.block) {
+		arena_reset(arena);
+		return;
+	}
+
+	arena->current = mark.block;
+	arena->current->used = mark.used;
+}
+
+/* Appends a block with room for at least size bytes. Blocks at least double
+ * in size, so a solve settles on a handful of them.
+ * */
+static struct arena_block *arena_grow(struct board_arena *arena, size_t size)
+{
+	struct arena_block *block;
+	size_t capacity = ARENA_MIN_BLOCK;
+
+	if (arena->last && capacity < 2 * arena->last->size)
+		capacity = 2 * arena->last->size;
+
+	if (capacity < size)
+		capacity = size;
+
+	block = malloc(ARENA_HEADER + capacity);
+
+	if (!block)
+		return NULL;
+
+	block->next = NULL;
+	block->size = capacity;
+	block->used = 0;
+
+	if (arena->last)
+		arena->last->next = block;
+	else
+		arena->first = block;
+
+	arena->last = block;
+
+	return block;
+}
@@ -0,0 +1,31 @@
+#ifndef MINESWEEPER_SOLVER_ARENA_H
+#define MINESWEEPER_SOLVER_ARENA_H
+
+#include <stddef.h>
+
+struct arena_block;
+
+/* Bump allocator for the temporaries of a solve. Memory is only ever handed
+ * back all at once, by arena_reset() or down to an arena_mark, and blocks
+ * are kept around to be reused until arena_destroy().
+ * */
+struct board_arena {
+	struct arena_block *first;
+	struct arena_block *current;	/* Being allocated from, NULL if none yet */
+	struct arena_block *last;
+};
+
+/* Everything allocated after arena_save() is freed by arena_restore() */
+struct arena_mark {
+	struct arena_block *block;
+	size_t used;
+};
+
+void arena_init(struct board_arena *arena);
+void arena_destroy(struct board_arena *arena);
+void *arena_alloc(struct board_arena *arena, size_t size);
+void arena_reset(struct board_arena *arena);
+struct arena_mark arena_save(const struct board_arena *arena);
+void arena_restore(struct board_arena *arena, struct arena_mark mark);
+
+#endif /* MINESWEEPER_SOLVER_ARENA_H */
@@ -0,0 +1,567 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "batch.h"
+#include "buf.h"
+#include "cache.h"
+#include "count.h"
+#include "prob.h"
+#include "stats.h"
+
+/* Boards read ahead and handed to the workers at once. Results of one chunk
+ * are written out before the next one is read.
+ * */
+#define BATCH_CHUNK 1024
+
+/* Converted text is written out whenever this much has piled up */
+#define BATCH_FLUSH (1 << 16)
+
+struct batch_job {
+	long id;
+	int status;
+	struct gr_buffer text;
+	struct gr_buffer out;
+};
+
+struct batch_pool {
+	const struct batch_options *options;
+	FILE *out;
+
+	pthread_mutex_t lock;
+	pthread_mutex_t out_lock;
+	pthread_cond_t work_ready;
+	pthread_cond_t work_done;
+
+	struct batch_job *jobs;
+	int n_jobs;
+	int next_job;
+	int finished;
+	int quit;
+	int failures;
+};
+
+static int batch_count(const struct minesweeper_board *board, int total_mines,
+		struct gr_buffer *out);
+static int batch_read_record(FILE *in, const struct batch_options *options,
+		struct gr_buffer *text, char **line, size_t *line_cap);
+static void batch_run_job(struct batch_pool *pool, struct batch_job *job,
+		struct deduce_cache *cache, struct board_stats *stats);
+static void *batch_worker(void *arg);
+static int line_is_blank(const char *line, ssize_t length);
+
+/* Solves or deduces whatever a board calls for and describes it in out.
+ * Returns non-zero if the board is broken or the solver is.
+ * */
+int batch_solve_one(struct minesweeper_board *board, const struct batch_options *options,
+		struct gr_buffer *out)
+{
+	int total_mines = 0;
+	int i;
+	int j;
+
+	board_to_string_buf(board, out);
+
+	if (board_is_full(board)) {
+		BUF_APPEND_STR(out, "Board is full. Attempting to solve from start.\n");
+
+		/* One start point goes for every board of a batch, whatever its size */
+		if (options->row < 0 || options->row >= board->rows
+				|| options->col < 0 || options->col >= board->cols
+				|| BOARD_AT(board, options->row, options->col) != TILE_CLEAR) {
+			BUF_APPEND_STR(out, "Starting point is not a clear tile!\n");
+			return 1;
+		}
+
+		for (i = 0; i < board->rows; i++)
+			for (j = 0; j < board->cols; j++)
+				total_mines += BOARD_AT(board, i, j) == TILE_MINE;
+
+		switch (board_solve_full(board, options->row, options->col, out)) {
+		case BOARD_SOLVE_SUCCESS:
+			BUF_APPEND_STR(out, "Board solved.\n");
+			break;
+		case BOARD_SOLVE_MUST_GUESS:
+			BUF_APPEND_STR(out, "Board cannot be solved without guessing.\n");
+
+			if (options->probabilities && batch_guess(board, total_mines, out))
+				return 1;
+
+			break;
+		default:
+			BUF_APPEND_STR(out, "BUG!\n");
+			return 1;
+		}
+	} else if (board_is_partial(board)) {
+		BUF_APPEND_STR(out, "A partial solution is given.\n");
+
+		if (!board_mine_numbers_consistent(board)) {
+			BUF_APPEND_STR(out, "Board mine number inconsistent!\n");
+			return 1;
+		}
+
+		if (options->count && batch_count(board, options->mines, out))
+			return 1;
+
+		BUF_APPEND_STR(out, "Mine numbers consistent. Attempting to deduce next moves.\n");
+
+		switch (board_deduce_partial(board, out)) {
+		case BOARD_SOLVE_MUST_GUESS:
+			if (options->probabilities && batch_guess(board, options->mines, out))
+				return 1;
+
+			break;
+		case BOARD_SOLVE_BUG:
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+/* Deduced tiles are forced either way, so this is done before deducing */
+static int batch_count(const struct minesweeper_board *board, int total_mines,
+		struct gr_buffer *out)
+{
+	struct bignum count;
+	int ret;
+
+	bignum_init(&count);
+	ret = count_solutions(board, total_mines, &count);
+
+	if (!ret) {
+		BUF_APPEND_STR(out, "Mine layouts: ");
+		bignum_to_string_buf(&count, out);
+		gr_buf_append_char(out, '\n');
+	}
+
+	bignum_destroy(&count);
+
+	return ret;
+}
+
+/* Describes how likely every unknown tile is to be a mine and which one is
+ * the safest to click.
+ * */
+int batch_guess(const struct minesweeper_board *board, int total_mines, struct gr_buffer *out)
+{
+	double *probabilities;
+	double best;
+	int row;
+	int col;
+	int ret;
+
+	probabilities = malloc((size_t)board->rows * board->cols * sizeof(probabilities[0]));
+
+	if (!probabilities)
+		return 1;
+
+	ret = prob_compute(board, total_mines, probabilities);
+
+	if (ret) {
+		if (ret == PROB_TOO_MANY_LAYOUTS)
+			BUF_APPEND_STR(out, "Too many mine layouts to weigh!\n");
+		else
+			BUF_APPEND_STR(out, "No mine layout fits the board!\n");
+
+		free(probabilities);
+		return 1;
+	}
+
+	BUF_APPEND_STR(out, "Mine probabilities (%):\n");
+	prob_to_string_buf(board, probabilities, out);
+
+	best = prob_best_guess(board, probabilities, &row, &col);
+
+	if (best >= 0)
+		buf_printf(out, "Best guess: %i %i (%.1f%% mine)\n", row, col, best * 100);
+
+	free(probabilities);
+
+	return 0;
+}
+
+/* Reads boards from in until it runs dry and solves them on a pool of worker
+ * threads, or on this one if none can be started. Unless results are tagged,
+ * they are written in input order, each followed by an empty line.
+ * */
+int batch_run(FILE *in, FILE *out, const struct batch_options *options)
+{
+	struct batch_pool pool;
+	struct batch_job *job;
+	struct deduce_cache cache;
+	struct deduce_cache *cachep = NULL;
+	struct board_stats stats = {0};
+	pthread_t *threads;
+	char *line = NULL;
+	size_t line_cap = 0;
+	long next_id = 0;
+	uint64_t start;
+	int n_threads;
+	int started = 0;
+	int eof = 0;
+	int i;
+
+	memset(&pool, 0, sizeof(pool));
+	pool.options = options;
+	pool.out = out;
+
+	n_threads = options->jobs;
+
+	if (n_threads <= 0)
+		n_threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n_threads <= 0)
+		n_threads = 1;
+
+	pool.jobs = calloc(BATCH_CHUNK, sizeof(pool.jobs[0]));
+	threads = calloc(n_threads, sizeof(threads[0]));
+
+	if (!pool.jobs || !threads) {
+		free(pool.jobs);
+		free(threads);
+		return 1;
+	}
+
+	for (i = 0; i < BATCH_CHUNK; i++) {
+		gr_buf_init(&pool.jobs[i].text, 256);
+		gr_buf_init(&pool.jobs[i].out, 1024);
+	}
+
+	pthread_mutex_init(&pool.lock, NULL);
+	pthread_mutex_init(&pool.out_lock, NULL);
+	pthread_cond_init(&pool.work_ready, NULL);
+	pthread_cond_init(&pool.work_done, NULL);
+
+	for (i = 0; i < n_threads; i++)
+		if (!pthread_create(&threads[started], NULL, batch_worker, &pool))
+			started++;
+
+	if (!started && !deduce_cache_init(&cache, DEDUCE_CACHE_DEFAULT_SIZE))
+		cachep = &cache;
+
+	while (!eof) {
+		start = options->stats ? board_stats_now_ns() : 0;
+
+		for (i = 0; i < BATCH_CHUNK; i++) {
+			gr_buf_clear(&pool.jobs[i].text);
+			gr_buf_clear(&pool.jobs[i].out);
+
+			if (batch_read_record(in, options, &pool.jobs[i].text, &line, &line_cap)) {
+				eof = 1;
+				break;
+			}
+
+			pool.jobs[i].id = next_id++;
+		}
+
+		if (!i)
+			break;
+
+		pthread_mutex_lock(&pool.lock);
+
+		if (options->stats)
+			options->stats->read_ns += board_stats_now_ns() - start;
+
+		pool.n_jobs = i;
+		pool.next_job = 0;
+		pool.finished = 0;
+
+		if (started) {
+			pthread_cond_broadcast(&pool.work_ready);
+
+			while (pool.finished < pool.n_jobs)
+				pthread_cond_wait(&pool.work_done, &pool.lock);
+		}
+
+		/* Without workers nothing else touches the pool */
+		for (; pool.next_job < pool.n_jobs; pool.finished++) {
+			job = &pool.jobs[pool.next_job++];
+			batch_run_job(&pool, job, cachep, options->stats ? &stats : NULL);
+
+			if (job->status)
+				pool.failures++;
+		}
+
+		pool.n_jobs = 0;
+		pthread_mutex_unlock(&pool.lock);
+
+		if (options->tagged)
+			continue;
+
+		start = options->stats ? board_stats_now_ns() : 0;
+
+		for (i = 0; i < pool.finished; i++) {
+			buf_write(&pool.jobs[i].out, out);
+			fputc('\n', out);
+		}
+
+		/* Workers only add theirs on the way out */
+		if (options->stats)
+			options->stats->write_ns += board_stats_now_ns() - start;
+	}
+
+	pthread_mutex_lock(&pool.lock);
+	pool.quit = 1;
+	pthread_cond_broadcast(&pool.work_ready);
+	pthread_mutex_unlock(&pool.lock);
+
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	if (options->stats)
+		board_stats_add(options->stats, &stats);
+
+	if (cachep)
+		deduce_cache_destroy(cachep);
+
+	for (i = 0; i < BATCH_CHUNK; i++) {
+		gr_buf_delete(&pool.jobs[i].text);
+		gr_buf_delete(&pool.jobs[i].out);
+	}
+
+	pthread_mutex_destroy(&pool.lock);
+	pthread_mutex_destroy(&pool.out_lock);
+	pthread_cond_destroy(&pool.work_ready);
+	pthread_cond_destroy(&pool.work_done);
+
+	free(line);
+	free(pool.jobs);
+	free(threads);
+	fflush(out);
+
+	return pool.failures != 0;
+}
+
+/* Reads boards the same way batch_run() does and writes them out as a binary
+ * corpus. Full boards know their mine count, partial ones get options->mines.
+ * */
+int batch_to_binary(FILE *in, FILE *out, const struct batch_options *options)
+{
+	struct minesweeper_board board;
+	struct board_bin_writer writer;
+	struct gr_buffer text;
+	char *line = NULL;
+	size_t line_cap = 0;
+	int mines;
+	int ret;
+	int i;
+	int j;
+
+	gr_buf_init(&text, 256);
+	ret = board_bin_writer_init(&writer, out);
+
+	while (!ret) {
+		gr_buf_clear(&text);
+
+		if (batch_read_record(in, options, &text, &line, &line_cap))
+			break;
+
+		board_read_buf(&board, text.buf, text.length);
+		mines = options->mines;
+
+		if (board_is_full(&board))
+			for (i = 0, mines = 0; i < board.rows; i++)
+				for (j = 0; j < board.cols; j++)
+					mines += BOARD_AT(&board, i, j) == TILE_MINE;
+
+		ret = board_bin_write(&writer, &board, mines);
+		board_destroy(&board);
+	}
+
+	if (board_bin_writer_finish(&writer))
+		ret = 1;
+
+	gr_buf_delete(&text);
+	free(line);
+	fflush(out);
+
+	return ret;
+}
+
+/* Writes every board of a binary corpus as text, each followed by an empty
+ * line, which is what batch_run() takes
+ * */
+int batch_to_text(FILE *in, FILE *out)
+{
+	struct minesweeper_board board;
+	struct board_bin bin;
+	struct gr_buffer text;
+	uint64_t i;
+	int ret = 0;
+
+	if (board_bin_load(&bin, in))
+		return 1;
+
+	gr_buf_init(&text, 1024);
+
+	for (i = 0; i < bin.n_boards; i++) {
+		if (board_bin_read(&bin, i, &board, NULL)) {
+			ret = 1;
+			break;
+		}
+
+		board_to_string_buf(&board, &text);
+		gr_buf_append_char(&text, '\n');
+		board_destroy(&board);
+
+		if (text.length >= BATCH_FLUSH) {
+			buf_write(&text, out);
+			gr_buf_clear(&text);
+		}
+	}
+
+	buf_write(&text, out);
+	gr_buf_delete(&text);
+	board_bin_close(&bin);
+
+	return ret;
+}
+
+static void *batch_worker(void *arg)
+{
+	struct batch_pool *pool = arg;
+	struct deduce_cache cache;
+	struct deduce_cache *cachep = NULL;
+	struct board_stats stats = {0};
+	struct batch_job *job;
+
+	/* Every worker keeps its own cache for the whole run */
+	if (!deduce_cache_init(&cache, DEDUCE_CACHE_DEFAULT_SIZE))
+		cachep = &cache;
+
+	pthread_mutex_lock(&pool->lock);
+
+	for (;;) {
+		while (!pool->quit && pool->next_job >= pool->n_jobs)
+			pthread_cond_wait(&pool->work_ready, &pool->lock);
+
+		if (pool->quit)
+			break;
+
+		job = &pool->jobs[pool->next_job++];
+		pthread_mutex_unlock(&pool->lock);
+
+		batch_run_job(pool, job, cachep, pool->options->stats ? &stats : NULL);
+
+		pthread_mutex_lock(&pool->lock);
+
+		if (job->status)
+			pool->failures++;
+
+		if (++pool->finished == pool->n_jobs)
+			pthread_cond_signal(&pool->work_done);
+	}
+
+	/* Still holding the lock */
+	if (pool->options->stats)
+		board_stats_add(pool->options->stats, &stats);
+
+	pthread_mutex_unlock(&pool->lock);
+
+	if (cachep)
+		deduce_cache_destroy(cachep);
+
+	return NULL;
+}
+
+/* Phases are only timed if stats is set */
+static void batch_run_job(struct batch_pool *pool, struct batch_job *job,
+		struct deduce_cache *cache, struct board_stats *stats)
+{
+	struct minesweeper_board board;
+	uint64_t start = stats ? board_stats_now_ns() : 0;
+
+	board_read_buf(&board, job->text.buf, job->text.length);
+	board.cache = cache;
+	board.pipeline = pool->options->pipeline;
+	board.stats = stats;
+
+	if (stats) {
+		stats->read_ns += board_stats_now_ns() - start;
+		start = board_stats_now_ns();
+	}
+
+	if (pool->options->tagged)
+		buf_printf(&job->out, "== %ld ==\n", job->id);
+
+	job->status = batch_solve_one(&board, pool->options, &job->out);
+	board_destroy(&board);
+
+	if (stats) {
+		stats->solve_ns += board_stats_now_ns() - start;
+		start = board_stats_now_ns();
+	}
+
+	if (!pool->options->tagged)
+		return;
+
+	pthread_mutex_lock(&pool->out_lock);
+	buf_write(&job->out, pool->out);
+	pthread_mutex_unlock(&pool->out_lock);
+
+	if (stats)
+		stats->write_ns += board_stats_now_ns() - start;
+}
+
+/* Reads the text of one board into text. Returns non-zero once there are no
+ * boards left.
+ * */
+static int batch_read_record(FILE *in, const struct batch_options *options,
+		struct gr_buffer *text, char **line, size_t *line_cap)
+{
+	ssize_t length;
+	size_t record_length;
+	size_t got;
+	char chunk[4096];
+	char *end;
+
+	/* Skip whatever separates this board from the previous one */
+	do {
+		length = getline(line, line_cap, in);
+
+		if (length < 0)
+			return 1;
+	} while (line_is_blank(*line, length));
+
+	if (!options->length_prefixed) {
+		do {
+			gr_buf_append(text, *line, length);
+			length = getline(line, line_cap, in);
+		} while (length >= 0 && !line_is_blank(*line, length));
+
+		return 0;
+	}
+
+	record_length = strtoul(*line, &end, 10);
+
+	if (end == *line)
+		return 1;
+
+	while (record_length) {
+		got = fread(chunk, 1, record_length < sizeof(chunk) ? record_length : sizeof(chunk), in);
+
+		if (!got)
+			break;
+
+		gr_buf_append(text, chunk, got);
+		record_length -= got;
+	}
+
+	return 0;
+}
+
+static int line_is_blank(const char *line, ssize_t length)
+{
+	ssize_t i;
+
+	for (i = 0; i < length; i++)
+		if (!isspace((unsigned char)line[i]))
+			return 0;
+
+	return 1;
+}
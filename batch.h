@@ -0,0 +1,35 @@
+#ifndef MINESWEEPER_SOLVER_BATCH_H
+#define MINESWEEPER_SOLVER_BATCH_H
+
+#include <stdio.h>
+
+#include <gramas/buf.h>
+
+#include "board.h"
+
+struct batch_options {
+	int row;		/* Starting point for full boards */
+	int col;
+	int jobs;		/* Worker threads, one per core if 0 */
+	int tagged;		/* Tag results with board ids, write as they finish */
+	int length_prefixed;	/* Each board is preceded by its size in bytes */
+	int probabilities;	/* Print mine probabilities when stuck */
+	int mines;		/* Mines on a partial board, -1 if not known */
+	int count;		/* Count the mine layouts of partial boards */
+
+	const struct board_pipeline *pipeline;	/* Rules to deduce with, all if NULL */
+
+	/* Summed over every board if set. Workers count on their own and add
+	 * theirs up once done.
+	 * */
+	struct board_stats *stats;
+};
+
+int batch_solve_one(struct minesweeper_board *board, const struct batch_options *options,
+		struct gr_buffer *out);
+int batch_guess(const struct minesweeper_board *board, int total_mines, struct gr_buffer *out);
+int batch_run(FILE *in, FILE *out, const struct batch_options *options);
+int batch_to_binary(FILE *in, FILE *out, const struct batch_options *options);
+int batch_to_text(FILE *in, FILE *out);
+
+#endif /* MINESWEEPER_SOLVER_BATCH_H */
@@ -0,0 +1,517 @@
+/* Times the solver on randomly generated boards. Boards come from a seeded
+ * generator, so two runs with the same seed solve exactly the same boards and
+ * their numbers can be compared.
+ * */
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <gramas/buf.h>
+
+#include "board.h"
+#include "cache.h"
+#include "gen.h"
+#include "mss.h"
+#include "prob.h"
+#include "rng.h"
+#include "sim.h"
+#include "snapshot.h"
+
+#define BENCH_DEFAULT_SEED	1
+#define BENCH_MAX_SIZES		16
+
+enum bench_format {
+	BENCH_FORMAT_TEXT,
+	BENCH_FORMAT_CSV,
+	BENCH_FORMAT_JSON,
+};
+
+enum bench_op {
+	BENCH_SOLVE_FULL,
+	BENCH_DEDUCE_PARTIAL,
+	BENCH_DEDUCE_SIMPLE,
+	BENCH_DEDUCE_PAIRS,
+	BENCH_DEDUCE_WINDOWS,
+	BENCH_DEDUCE_FRONTIER,
+	BENCH_PROBABILITIES,
+	BENCH_SOLVER_PLAY,
+	BENCH_SPECULATE,
+	BENCH_N_OPS
+};
+
+static const char *const bench_op_names[] = {
+	"solve_full",
+	"deduce_partial",
+	"deduce_simple",
+	"deduce_pairs",
+	"deduce_windows",
+	"deduce_frontier",
+	"probabilities",
+	"solver_play",
+	"speculate",
+};
+
+struct bench_size {
+	const char *name;
+	int rows;
+	int cols;
+	int boards;
+};
+
+static const struct bench_size default_sizes[] = {
+	{ "beginner", 9, 9, 2000 },
+	{ "intermediate", 16, 16, 1000 },
+	{ "expert", 16, 30, 500 },
+	{ "huge", 256, 256, 3 },
+};
+
+static const double densities[] = { 0.12, 0.16, 0.206 };
+
+struct bench_result {
+	const char *size;
+	int rows;
+	int cols;
+	double density;
+	enum bench_op op;
+	int boards;
+	uint64_t total_ns;
+	uint64_t p50_ns;
+	uint64_t p90_ns;
+	uint64_t p99_ns;
+};
+
+static int compare_u64(const void *a, const void *b);
+static uint64_t now_ns(void);
+static int parse_i(const char *str, int *ret);
+static void play(const struct minesweeper_board *full, const struct minesweeper_board *partial);
+static void print_result(const struct bench_result *result, enum bench_format format, int first);
+static void speculate(struct minesweeper_board *board);
+static void run_case(const struct bench_size *size, double density, uint64_t seed,
+		enum bench_format format, int *first);
+static uint64_t time_op(enum bench_op op, const struct minesweeper_board *full,
+		const struct minesweeper_board *partial, int row, int col, int mines,
+		struct deduce_cache *cache, struct gr_buffer *out, double *probabilities);
+static void usage(const char *argv0);
+
+int main(int argc, char **argv)
+{
+	struct bench_size sizes[BENCH_MAX_SIZES];
+	enum bench_format format = BENCH_FORMAT_TEXT;
+	uint64_t seed = BENCH_DEFAULT_SEED;
+	char *endptr;
+	int n_sizes = 0;
+	int boards = 0;
+	int first = 1;
+	int i;
+	int j;
+	int k;
+	int mines;
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--format") && i + 1 < argc) {
+			i++;
+
+			if (!strcmp(argv[i], "text")) {
+				format = BENCH_FORMAT_TEXT;
+			} else if (!strcmp(argv[i], "csv")) {
+				format = BENCH_FORMAT_CSV;
+			} else if (!strcmp(argv[i], "json")) {
+				format = BENCH_FORMAT_JSON;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+			errno = 0;
+			seed = strtoull(argv[++i], &endptr, 0);
+
+			if (errno || *endptr) {
+				usage(argv[0]);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--boards") && i + 1 < argc) {
+			if (parse_i(argv[++i], &boards) || boards <= 0) {
+				usage(argv[0]);
+				return 1;
+			}
+		} else if (!strcmp(argv[i], "--size") && i + 1 < argc && n_sizes < BENCH_MAX_SIZES) {
+			i++;
+
+			for (j = 0; j < (int)(sizeof(default_sizes) / sizeof(default_sizes[0])); j++)
+				if (!strcmp(argv[i], default_sizes[j].name))
+					break;
+
+			if (j < (int)(sizeof(default_sizes) / sizeof(default_sizes[0]))) {
+				sizes[n_sizes++] = default_sizes[j];
+			} else if (!sim_size_parse(argv[i], &j, &k, &mines)) {
+				sizes[n_sizes].name = "custom";
+				sizes[n_sizes].rows = j;
+				sizes[n_sizes].cols = k;
+				/* Roughly a million tiles worth of boards */
+				sizes[n_sizes].boards = 1000000 / ((long)j * k) + 1;
+				n_sizes++;
+			} else {
+				usage(argv[0]);
+				return 1;
+			}
+		} else {
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!n_sizes) {
+		n_sizes = sizeof(default_sizes) / sizeof(default_sizes[0]);
+		memcpy(sizes, default_sizes, sizeof(default_sizes));
+	}
+
+	if (boards)
+		for (i = 0; i < n_sizes; i++)
+			sizes[i].boards = boards;
+
+	if (format == BENCH_FORMAT_CSV)
+		puts("size,rows,cols,density,op,boards,boards_per_s,ns_per_tile,p50_ns,p90_ns,p99_ns");
+	else if (format == BENCH_FORMAT_JSON)
+		puts("[");
+	else
+		printf("%-12s %11s %7s %-16s %12s %10s %10s %10s %10s\n",
+				"size", "rows x cols", "density", "op",
+				"boards/s", "ns/tile", "p50 us", "p90 us", "p99 us");
+
+	/* Every case gets a seed of its own, so adding or skipping a size
+	 * does not change the boards of the others.
+	 * */
+	for (i = 0; i < n_sizes; i++)
+		for (j = 0; j < (int)(sizeof(densities) / sizeof(densities[0])); j++)
+			run_case(&sizes[i], densities[j],
+					seed ^ ((uint64_t)sizes[i].rows << 40)
+					^ ((uint64_t)sizes[i].cols << 16) ^ (uint64_t)j,
+					format, &first);
+
+	if (format == BENCH_FORMAT_JSON)
+		puts("\n]");
+
+	return 0;
+}
+
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [--format text|csv|json] [--seed N] [--boards N] [--size NAME|RxC]...\n", argv0);
+	fprintf(stderr, "Sizes: beginner, intermediate, expert, huge or rows x cols, e.g. 500x2000\n");
+}
+
+/* Generates size->boards boards and times every operation on each of them.
+ * Full solves start at the center, which the generator keeps clear, and the
+ * partial boards are what a player sees after clicking there.
+ * */
+static void run_case(const struct bench_size *size, double density, uint64_t seed,
+		enum bench_format format, int *first)
+{
+	struct minesweeper_board *full;
+	struct minesweeper_board *partial;
+	struct deduce_cache cache;
+	struct deduce_cache *cachep = NULL;
+	struct bench_result result;
+	struct gr_buffer out;
+	struct rng rng;
+	uint64_t *samples;
+	double *probabilities;
+	int mines;
+	int row = size->rows / 2;
+	int col = size->cols / 2;
+	int n = 0;
+	int i;
+	int op;
+
+	full = calloc(size->boards, sizeof(full[0]));
+	partial = calloc(size->boards, sizeof(partial[0]));
+	samples = malloc(size->boards * sizeof(samples[0]));
+	probabilities = malloc((size_t)size->rows * size->cols * sizeof(probabilities[0]));
+
+	if (!full || !partial || !samples || !probabilities)
+		goto end;
+
+	rng_seed(&rng, seed);
+	mines = (int)(density * size->rows * size->cols + 0.5);
+
+	for (n = 0; n < size->boards; n++) {
+		if (board_generate(&full[n], size->rows, size->cols, mines, row, col, &rng))
+			break;
+
+		if (board_generate_opening(&partial[n], &full[n], row, col)) {
+			board_destroy(&full[n]);
+			board_destroy(&partial[n]);
+			break;
+		}
+	}
+
+	/* Same cache for the whole run, as with batch mode */
+	if (!deduce_cache_init(&cache, DEDUCE_CACHE_DEFAULT_SIZE))
+		cachep = &cache;
+
+	gr_buf_init(&out, 4096);
+
+	for (op = 0; op < BENCH_N_OPS; op++) {
+		memset(&result, 0, sizeof(result));
+		result.size = size->name;
+		result.rows = size->rows;
+		result.cols = size->cols;
+		result.density = density;
+		result.op = op;
+		result.boards = n;
+
+		for (i = 0; i < n; i++) {
+			samples[i] = time_op(op, &full[i], &partial[i], row, col, mines,
+					cachep, &out, probabilities);
+			result.total_ns += samples[i];
+		}
+
+		if (n) {
+			qsort(samples, n, sizeof(samples[0]), compare_u64);
+			result.p50_ns = samples[(n - 1) * 50 / 100];
+			result.p90_ns = samples[(n - 1) * 90 / 100];
+			result.p99_ns = samples[(n - 1) * 99 / 100];
+		}
+
+		print_result(&result, format, *first);
+		*first = 0;
+	}
+
+	gr_buf_delete(&out);
+
+	if (cachep)
+		deduce_cache_destroy(cachep);
+
+end:
+	for (i = 0; i < n; i++) {
+		board_destroy(&full[i]);
+		board_destroy(&partial[i]);
+	}
+
+	free(full);
+	free(partial);
+	free(samples);
+	free(probabilities);
+}
+
+/* Runs op on a copy of the board it takes, so the originals can be reused,
+ * and returns how long it took. Copying is not timed.
+ * */
+static uint64_t time_op(enum bench_op op, const struct minesweeper_board *full,
+		const struct minesweeper_board *partial, int row, int col, int mines,
+		struct deduce_cache *cache, struct gr_buffer *out, double *probabilities)
+{
+	struct minesweeper_board board;
+	uint64_t start;
+	uint64_t end;
+
+	board_copy(&board, op == BENCH_SOLVE_FULL ? full : partial);
+	board.cache = cache;
+	gr_buf_clear(out);
+
+	start = now_ns();
+
+	switch (op) {
+	case BENCH_SOLVE_FULL:
+		board_solve_full(&board, row, col, out);
+		break;
+	case BENCH_DEDUCE_PARTIAL:
+		board_deduce_partial(&board, out);
+		break;
+	case BENCH_DEDUCE_SIMPLE:
+		board_deduce_simple(&board);
+		break;
+	case BENCH_DEDUCE_PAIRS:
+		board_deduce_pairs(&board);
+		break;
+	case BENCH_DEDUCE_WINDOWS:
+		board_deduce_windows(&board);
+		break;
+	case BENCH_DEDUCE_FRONTIER:
+		board_deduce_frontier(&board);
+		break;
+	case BENCH_PROBABILITIES:
+		prob_compute(&board, mines, probabilities);
+		break;
+	case BENCH_SOLVER_PLAY:
+		play(full, &board);
+		break;
+	case BENCH_SPECULATE:
+		speculate(&board);
+		break;
+	default:
+		break;
+	}
+
+	end = now_ns();
+	board_destroy(&board);
+
+	return end - start;
+}
+
+/* Plays the game out from partial with the incremental solver, revealing or
+ * flagging every tile it deduces, like a bot would, until it gets stuck.
+ * */
+static void play(const struct minesweeper_board *full, const struct minesweeper_board *partial)
+{
+	const struct mss_delta *deltas;
+	struct mss_solver *solver;
+	struct mss_delta *todo;
+	int n_todo;
+	int n;
+	int i;
+	int r;
+	int c;
+
+	solver = mss_solver_create(partial, MSS_SOLVER_DEFAULT);
+	todo = malloc((size_t)full->rows * full->cols * sizeof(todo[0]));
+
+	if (!solver || !todo)
+		goto end;
+
+	n = mss_solver_deduce(solver, &deltas);
+	n_todo = 0;
+
+	while (n > 0 || n_todo) {
+		for (i = 0; i < n; i++)
+			todo[n_todo++] = deltas[i];
+
+		r = todo[--n_todo].row;
+		c = todo[n_todo].col;
+
+		if (todo[n_todo].mine)
+			n = mss_solver_flag(solver, r, c, &deltas);
+		else
+			n = mss_solver_reveal(solver, r, c,
+					board_count_neighbor_mines(full, r, c), &deltas);
+	}
+
+end:
+	free(todo);
+	mss_solver_destroy(solver);
+}
+
+/* Supposes every unknown tile next to a number is a mine, one at a time on a
+ * branch of its own, and rolls the board back after each, the way a lookahead
+ * search would. Only the snapshots are timed, nothing is deduced on them.
+ * */
+static void speculate(struct minesweeper_board *board)
+{
+	struct snapshot_store store;
+	struct board_snapshot *base;
+	struct board_snapshot *branch;
+	unsigned char *tile;
+	int numbers;
+	int i;
+	int j;
+	int k;
+	int l;
+
+	snapshot_store_init(&store, board);
+	base = snapshot_take(&store, board, NULL);
+
+	for (i = 0; base && i < board->rows; i++) {
+		for (j = 0; j < board->cols; j++) {
+			if (BOARD_AT(board, i, j) != TILE_UNKNOWN)
+				continue;
+
+			numbers = 0;
+
+			BOARD_FOREACH_NEIGHBOR(board, i, j, k, l, tile)
+				numbers += *tile <= 8;
+
+			if (!numbers)
+				continue;
+
+			BOARD_AT(board, i, j) = TILE_DEDUCED_MINE;
+			branch = snapshot_take(&store, board, base);
+			snapshot_restore(base, board);
+			snapshot_release(branch);
+		}
+	}
+
+	snapshot_release(base);
+	snapshot_store_destroy(&store);
+}
+
+static void print_result(const struct bench_result *result, enum bench_format format, int first)
+{
+	double seconds = result->total_ns / 1e9;
+	double boards_per_s = seconds > 0 ? result->boards / seconds : 0;
+	double tiles = (double)result->boards * result->rows * result->cols;
+	double ns_per_tile = tiles > 0 ? result->total_ns / tiles : 0;
+	char dims[32];
+
+	switch (format) {
+	case BENCH_FORMAT_CSV:
+		printf("%s,%i,%i,%.3f,%s,%i,%.1f,%.3f,%llu,%llu,%llu\n",
+				result->size, result->rows, result->cols, result->density,
+				bench_op_names[result->op], result->boards,
+				boards_per_s, ns_per_tile,
+				(unsigned long long)result->p50_ns,
+				(unsigned long long)result->p90_ns,
+				(unsigned long long)result->p99_ns);
+		break;
+	case BENCH_FORMAT_JSON:
+		printf("%s\n  {\"size\": \"%s\", \"rows\": %i, \"cols\": %i, \"density\": %.3f, "
+				"\"op\": \"%s\", \"boards\": %i, \"boards_per_s\": %.1f, "
+				"\"ns_per_tile\": %.3f, \"p50_ns\": %llu, \"p90_ns\": %llu, \"p99_ns\": %llu}",
+				first ? "" : ",",
+				result->size, result->rows, result->cols, result->density,
+				bench_op_names[result->op], result->boards,
+				boards_per_s, ns_per_tile,
+				(unsigned long long)result->p50_ns,
+				(unsigned long long)result->p90_ns,
+				(unsigned long long)result->p99_ns);
+		break;
+	default:
+		snprintf(dims, sizeof(dims), "%ix%i", result->rows, result->cols);
+		printf("%-12s %11s %7.3f %-16s %12.1f %10.3f %10.1f %10.1f %10.1f\n",
+				result->size, dims, result->density,
+				bench_op_names[result->op],
+				boards_per_s, ns_per_tile,
+				result->p50_ns / 1e3, result->p90_ns / 1e3, result->p99_ns / 1e3);
+		break;
+	}
+
+	fflush(stdout);
+}
+
+static uint64_t now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static int parse_i(const char *str, int *ret)
+{
+	long maybe_ret;
+	char *endptr;
+
+	errno = 0;
+	maybe_ret = strtol(str, &endptr, 0);
+
+	if (*endptr || errno || maybe_ret < INT_MIN || maybe_ret > INT_MAX)
+		return 1;
+
+	*ret = (int)maybe_ret;
+
+	return 0;
+}
@@ -0,0 +1,229 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bignum.h"
+#include "buf.h"
+
+/* Limbs printed at a time, the largest power of ten that fits one */
+#define BIGNUM_DECIMAL_BASE	1000000000u
+#define BIGNUM_DECIMAL_DIGITS	9
+
+static int bignum_reserve(struct bignum *num, int n_limbs);
+static void bignum_trim(struct bignum *num);
+
+void bignum_init(struct bignum *num)
+{
+	num->limbs = NULL;
+	num->n_limbs = 0;
+	num->capacity = 0;
+}
+
+void bignum_destroy(struct bignum *num)
+{
+	free(num->limbs);
+	bignum_init(num);
+}
+
+int bignum_set_u64(struct bignum *num, uint64_t value)
+{
+	if (bignum_reserve(num, 2))
+		return 1;
+
+	num->limbs[0] = (uint32_t)value;
+	num->limbs[1] = (uint32_t)(value >> 32);
+	num->n_limbs = 2;
+	bignum_trim(num);
+
+	return 0;
+}
+
+int bignum_copy(struct bignum *dst, const struct bignum *src)
+{
+	if (bignum_reserve(dst, src->n_limbs))
+		return 1;
+
+	if (src->n_limbs)
+		memcpy(dst->limbs, src->limbs, src->n_limbs * sizeof(src->limbs[0]));
+
+	dst->n_limbs = src->n_limbs;
+
+	return 0;
+}
+
+int bignum_add(struct bignum *num, const struct bignum *addend)
+{
+	uint64_t carry = 0;
+	int n = num->n_limbs > addend->n_limbs ? num->n_limbs : addend->n_limbs;
+	int i;
+
+	if (bignum_reserve(num, n + 1))
+		return 1;
+
+	for (i = num->n_limbs; i <= n; i++)
+		num->limbs[i] = 0;
+
+	for (i = 0; i < n; i++) {
+		carry += num->limbs[i];
+
+		if (i < addend->n_limbs)
+			carry += addend->limbs[i];
+
+		num->limbs[i] = (uint32_t)carry;
+		carry >>= 32;
+	}
+
+	num->limbs[n] = (uint32_t)carry;
+	num->n_limbs = n + 1;
+	bignum_trim(num);
+
+	return 0;
+}
+
+/* num += a * b, the schoolbook way. num must not be a or b. */
+int bignum_add_mul(struct bignum *num, const struct bignum *a, const struct bignum *b)
+{
+	uint64_t carry;
+	int n;
+	int i;
+	int j;
+
+	if (!a->n_limbs || !b->n_limbs)
+		return 0;
+
+	n = a->n_limbs + b->n_limbs;
+	n = (num->n_limbs > n ? num->n_limbs : n) + 1;
+
+	if (bignum_reserve(num, n))
+		return 1;
+
+	for (i = num->n_limbs; i < n; i++)
+		num->limbs[i] = 0;
+
+	for (i = 0; i < a->n_limbs; i++) {
+		carry = 0;
+
+		for (j = 0; j < b->n_limbs; j++) {
+			carry += (uint64_t)a->limbs[i] * b->limbs[j] + num->limbs[i + j];
+			num->limbs[i + j] = (uint32_t)carry;
+			carry >>= 32;
+		}
+
+		for (j += i; carry; j++) {
+			carry += num->limbs[j];
+			num->limbs[j] = (uint32_t)carry;
+			carry >>= 32;
+		}
+	}
+
+	num->n_limbs = n;
+	bignum_trim(num);
+
+	return 0;
+}
+
+int bignum_mul_u32(struct bignum *num, uint32_t factor)
+{
+	uint64_t carry = 0;
+	int i;
+
+	for (i = 0; i < num->n_limbs; i++) {
+		carry += (uint64_t)num->limbs[i] * factor;
+		num->limbs[i] = (uint32_t)carry;
+		carry >>= 32;
+	}
+
+	if (carry) {
+		if (bignum_reserve(num, num->n_limbs + 1))
+			return 1;
+
+		num->limbs[num->n_limbs++] = (uint32_t)carry;
+	}
+
+	bignum_trim(num);
+
+	return 0;
+}
+
+/* Divides in place and returns the remainder */
+uint32_t bignum_div_u32(struct bignum *num, uint32_t divisor)
+{
+	uint64_t rest = 0;
+	int i;
+
+	for (i = num->n_limbs - 1; i >= 0; i--) {
+		rest = rest << 32 | num->limbs[i];
+		num->limbs[i] = (uint32_t)(rest / divisor);
+		rest %= divisor;
+	}
+
+	bignum_trim(num);
+
+	return (uint32_t)rest;
+}
+
+/* Writes the number in decimal. Nine digits are split off at a time, least
+ * significant first, and printed the other way around.
+ * */
+int bignum_to_string_buf(const struct bignum *num, struct gr_buffer *out)
+{
+	struct bignum rest;
+	uint32_t *chunks;
+	int n_chunks = 0;
+	int i;
+
+	if (!num->n_limbs) {
+		gr_buf_append_char(out, '0');
+		return 0;
+	}
+
+	/* Every limb makes for less than two chunks */
+	chunks = malloc(2 * num->n_limbs * sizeof(chunks[0]));
+	bignum_init(&rest);
+
+	if (!chunks || bignum_copy(&rest, num)) {
+		free(chunks);
+		bignum_destroy(&rest);
+		return 1;
+	}
+
+	while (rest.n_limbs)
+		chunks[n_chunks++] = bignum_div_u32(&rest, BIGNUM_DECIMAL_BASE);
+
+	buf_printf(out, "%u", chunks[n_chunks - 1]);
+
+	for (i = n_chunks - 2; i >= 0; i--)
+		buf_printf(out, "%0*u", BIGNUM_DECIMAL_DIGITS, chunks[i]);
+
+	free(chunks);
+	bignum_destroy(&rest);
+
+	return 0;
+}
+
+static int bignum_reserve(struct bignum *num, int n_limbs)
+{
+	uint32_t *limbs;
+	int capacity = num->capacity ? num->capacity : 4;
+
+	if (n_limbs <= num->capacity)
+		return 0;
+
+	while (capacity < n_limbs)
+		capacity *= 2;
+
+	limbs = realloc(num->limbs, capacity * sizeof(limbs[0]));
+
+	if (!limbs)
+		return 1;
+
+	num->limbs = limbs;
+	num->capacity = capacity;
+
+	return 0;
+}
+
+static void bignum_trim(struct bignum *num)
+{
+	while (num->n_limbs && !num->limbs[num->n_limbs - 1])
+		num->n_limbs--;
+}
@@ -0,0 +1,29 @@
+#ifndef MINESWEEPER_SOLVER_BIGNUM_H
+#define MINESWEEPER_SOLVER_BIGNUM_H
+
+#include <stdint.h>
+
+#include <gramas/buf.h>
+
+/* Non-negative integer of any size, for counts of mine layouts that do not
+ * fit 64 bits. Limbs are stored least significant first with no zero limbs
+ * on top, so zero has none. Functions that can grow a number return non-zero
+ * if memory runs out.
+ * */
+struct bignum {
+	uint32_t *limbs;
+	int n_limbs;
+	int capacity;
+};
+
+void bignum_init(struct bignum *num);
+void bignum_destroy(struct bignum *num);
+int bignum_set_u64(struct bignum *num, uint64_t value);
+int bignum_copy(struct bignum *dst, const struct bignum *src);
+int bignum_add(struct bignum *num, const struct bignum *addend);
+int bignum_add_mul(struct bignum *num, const struct bignum *a, const struct bignum *b);
+int bignum_mul_u32(struct bignum *num, uint32_t factor);
+uint32_t bignum_div_u32(struct bignum *num, uint32_t divisor);
+int bignum_to_string_buf(const struct bignum *num, struct gr_buffer *out);
+
+#endif /* MINESWEEPER_SOLVER_BIGNUM_H */
@@ -0,0 +1,287 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "bitboard.h"
+
+#define BITBOARD_PLANES 10
+
+#if defined(__GNUC__) && !defined(BITBOARD_NO_SIMD)
+#	if defined(__AVX2__)
+#		define BITBOARD_LANES 4
+#	else
+#		define BITBOARD_LANES 2
+#	endif
+typedef uint64_t bitboard_vec __attribute__((vector_size(8 * BITBOARD_LANES)));
+#endif
+
+/* Adds up the eight neighbors of every bit at once. Each neighbor is a full
+ * word (or vector) shifted so that the neighbor of a tile lines up with the
+ * tile itself. The result is a 4 bit count, one bit-plane per output.
+ *
+ *	up_w   up   up_e
+ *	mid_w   X   mid_e
+ *	down_w down down_e
+ * */
+#define BITBOARD_ADD_NEIGHBORS(__type)						\
+	__type s1, c1, s2, c2, s3, c3, s4, c4, s5, c5, s6, c6;			\
+										\
+	s1 = up_w ^ up ^ up_e;							\
+	c1 = (up_w & up) | (up_e & (up_w ^ up));				\
+	s2 = down_w ^ down ^ down_e;						\
+	c2 = (down_w & down) | (down_e & (down_w ^ down));			\
+	s3 = mid_w ^ mid_e;							\
+	c3 = mid_w & mid_e;							\
+										\
+	s4 = s1 ^ s2 ^ s3;							\
+	c4 = (s1 & s2) | (s3 & (s1 ^ s2));					\
+										\
+	s5 = c1 ^ c2 ^ c3;							\
+	c5 = (c1 & c2) | (c3 & (c1 ^ c2));					\
+	s6 = s5 ^ c4;								\
+	c6 = s5 & c4;								\
+										\
+	*bit0 = s4;								\
+	*bit1 = s6;								\
+	*bit2 = c5 ^ c6;							\
+	*bit3 = c5 & c6;
+
+static inline void bitboard_add_neighbors(
+		uint64_t up_w, uint64_t up, uint64_t up_e,
+		uint64_t mid_w, uint64_t mid_e,
+		uint64_t down_w, uint64_t down, uint64_t down_e,
+		uint64_t *bit0, uint64_t *bit1, uint64_t *bit2, uint64_t *bit3)
+{
+	BITBOARD_ADD_NEIGHBORS(uint64_t)
+}
+
+#ifdef BITBOARD_LANES
+static inline void bitboard_add_neighbors_vec(
+		bitboard_vec up_w, bitboard_vec up, bitboard_vec up_e,
+		bitboard_vec mid_w, bitboard_vec mid_e,
+		bitboard_vec down_w, bitboard_vec down, bitboard_vec down_e,
+		bitboard_vec *bit0, bitboard_vec *bit1, bitboard_vec *bit2, bitboard_vec *bit3)
+{
+	BITBOARD_ADD_NEIGHBORS(bitboard_vec)
+}
+
+static inline bitboard_vec bitboard_load(const uint64_t *words)
+{
+	bitboard_vec ret;
+
+	memcpy(&ret, words, sizeof(ret));
+	return ret;
+}
+
+static inline void bitboard_store(uint64_t *words, bitboard_vec vec)
+{
+	memcpy(words, &vec, sizeof(vec));
+}
+#endif
+
+/* Word of a row shifted so that each bit holds its western (left) or eastern
+ * (right) neighbor. The padding words make w - 1 and w + 1 always valid.
+ * */
+#define WEST(__row, __w)	(((__row)[__w] << 1) | ((__row)[(__w) - 1] >> 63))
+#define EAST(__row, __w)	(((__row)[__w] >> 1) | ((__row)[(__w) + 1] << 63))
+
+int bitboard_init(struct bitboard *bb, int rows, int cols)
+{
+	int i;
+
+	memset(bb, 0, sizeof(*bb));
+
+	bb->rows = rows;
+	bb->cols = cols;
+	bb->words = (cols + 63) / 64;
+	bb->stride = bb->words + 2;
+	bb->storage = calloc((size_t)BITBOARD_PLANES * (rows + 2) * bb->stride,
+			sizeof(bb->storage[0]));
+
+	if (!bb->storage)
+		return 1;
+
+	bb->mine = bb->storage;
+	bb->unknown = bb->mine + (rows + 2) * bb->stride;
+	bb->deduced = bb->unknown + (rows + 2) * bb->stride;
+	bb->open = bb->deduced + (rows + 2) * bb->stride;
+	bb->known_mine = bb->open + (rows + 2) * bb->stride;
+	bb->numbered = bb->known_mine + (rows + 2) * bb->stride;
+
+	for (i = 0; i < 4; i++)
+		bb->number[i] = bb->numbered + (i + 1) * (rows + 2) * bb->stride;
+
+	return 0;
+}
+
+void bitboard_destroy(struct bitboard *bb)
+{
+	free(bb->storage);
+	memset(bb, 0, sizeof(*bb));
+}
+
+void bitboard_from_board(struct bitboard *bb, const struct minesweeper_board *board)
+{
+	int i;
+	int j;
+	int k;
+	int w;
+	uint64_t bit;
+	unsigned char tile;
+
+	for (i = 0; i < board->rows; i++) {
+		for (w = 0; w < bb->words; w++) {
+			BITBOARD_ROW(bb, bb->mine, i)[w] = 0;
+			BITBOARD_ROW(bb, bb->unknown, i)[w] = 0;
+			BITBOARD_ROW(bb, bb->deduced, i)[w] = 0;
+			BITBOARD_ROW(bb, bb->numbered, i)[w] = 0;
+
+			for (k = 0; k < 4; k++)
+				BITBOARD_ROW(bb, bb->number[k], i)[w] = 0;
+		}
+
+		for (j = 0; j < board->cols; j++) {
+			tile = BOARD_AT(board, i, j);
+			bit = (uint64_t)1 << (j % 64);
+			w = j / 64;
+
+			if (tile & TILE_MINE) BITBOARD_ROW(bb, bb->mine, i)[w] |= bit;
+			if (tile & TILE_UNKNOWN) BITBOARD_ROW(bb, bb->unknown, i)[w] |= bit;
+			if (tile & TILE_DEDUCED) BITBOARD_ROW(bb, bb->deduced, i)[w] |= bit;
+
+			if (tile > 8)
+				continue;
+
+			BITBOARD_ROW(bb, bb->numbered, i)[w] |= bit;
+
+			for (k = 0; k < 4; k++)
+				if (tile & (1 << k))
+					BITBOARD_ROW(bb, bb->number[k], i)[w] |= bit;
+		}
+
+		for (w = 0; w < bb->words; w++) {
+			BITBOARD_ROW(bb, bb->open, i)[w] = BITBOARD_ROW(bb, bb->unknown, i)[w]
+				& ~BITBOARD_ROW(bb, bb->deduced, i)[w];
+			BITBOARD_ROW(bb, bb->known_mine, i)[w] = BITBOARD_ROW(bb, bb->mine, i)[w]
+				& ~BITBOARD_ROW(bb, bb->open, i)[w];
+		}
+	}
+}
+
+/* Counts how many neighbors of every tile in a row are set in a plane. The
+ * count is bit-sliced: bit k of the count of tile j is bit j of
+ * count[k * words .. (k + 1) * words - 1].
+ * */
+void bitboard_count_row(const struct bitboard *bb, const uint64_t *plane, int row, uint64_t *count)
+{
+	const uint64_t *above = BITBOARD_ROW(bb, plane, row - 1);
+	const uint64_t *here = BITBOARD_ROW(bb, plane, row);
+	const uint64_t *below = BITBOARD_ROW(bb, plane, row + 1);
+	int words = bb->words;
+	int w = 0;
+
+#ifdef BITBOARD_LANES
+	bitboard_vec v[4];
+	bitboard_vec x;
+	bitboard_vec prev;
+	bitboard_vec next;
+	bitboard_vec up_w, up, up_e;
+	bitboard_vec mid_w, mid_e;
+	bitboard_vec down_w, down, down_e;
+
+	for (; w + BITBOARD_LANES <= words; w += BITBOARD_LANES) {
+		x = bitboard_load(above + w);
+		prev = bitboard_load(above + w - 1);
+		next = bitboard_load(above + w + 1);
+		up = x;
+		up_w = (x << 1) | (prev >> 63);
+		up_e = (x >> 1) | (next << 63);
+
+		x = bitboard_load(here + w);
+		prev = bitboard_load(here + w - 1);
+		next = bitboard_load(here + w + 1);
+		mid_w = (x << 1) | (prev >> 63);
+		mid_e = (x >> 1) | (next << 63);
+
+		x = bitboard_load(below + w);
+		prev = bitboard_load(below + w - 1);
+		next = bitboard_load(below + w + 1);
+		down = x;
+		down_w = (x << 1) | (prev >> 63);
+		down_e = (x >> 1) | (next << 63);
+
+		bitboard_add_neighbors_vec(up_w, up, up_e, mid_w, mid_e,
+				down_w, down, down_e,
+				&v[0], &v[1], &v[2], &v[3]);
+
+		bitboard_store(count + w, v[0]);
+		bitboard_store(count + words + w, v[1]);
+		bitboard_store(count + 2 * words + w, v[2]);
+		bitboard_store(count + 3 * words + w, v[3]);
+	}
+#endif
+
+	for (; w < words; w++) {
+		bitboard_add_neighbors(
+				WEST(above, w), above[w], EAST(above, w),
+				WEST(here, w), EAST(here, w),
+				WEST(below, w), below[w], EAST(below, w),
+				&count[w], &count[words + w],
+				&count[2 * words + w], &count[3 * words + w]);
+	}
+}
+
+/* Marks the numbered tiles of a row on which board_deduce_from_tile() would
+ * make progress: tiles that still have unknown neighbors and whose number
+ * equals either the known mines around them (the rest is clear) or the known
+ * mines plus the unknown tiles (the rest are mines).
+ *
+ * scratch must hold 8 * words words.
+ * */
+void bitboard_simple_rules(const struct bitboard *bb, int row, uint64_t *scratch, uint64_t *fires)
+{
+	const uint64_t *numbered = BITBOARD_ROW(bb, bb->numbered, row);
+	const uint64_t *n[4];
+	uint64_t *mines = scratch;
+	uint64_t *unknown = scratch + 4 * bb->words;
+	uint64_t m[4];
+	uint64_t u[4];
+	uint64_t sum[4];
+	uint64_t carry;
+	uint64_t all_clear;
+	uint64_t all_mines;
+	int words = bb->words;
+	int w;
+	int k;
+
+	for (k = 0; k < 4; k++)
+		n[k] = BITBOARD_ROW(bb, bb->number[k], row);
+
+	bitboard_count_row(bb, bb->known_mine, row, mines);
+	bitboard_count_row(bb, bb->open, row, unknown);
+
+	for (w = 0; w < words; w++) {
+		for (k = 0; k < 4; k++) {
+			m[k] = mines[k * words + w];
+			u[k] = unknown[k * words + w];
+		}
+
+		/* Bit-sliced mines + unknown. Never exceeds 8. */
+		carry = 0;
+
+		for (k = 0; k < 4; k++) {
+			sum[k] = m[k] ^ u[k] ^ carry;
+			carry = (m[k] & u[k]) | (carry & (m[k] ^ u[k]));
+		}
+
+		all_clear = ~0ULL;
+		all_mines = ~0ULL;
+
+		for (k = 0; k < 4; k++) {
+			all_clear &= ~(n[k][w] ^ m[k]);
+			all_mines &= ~(n[k][w] ^ sum[k]);
+		}
+
+		fires[w] = numbered[w] & (u[0] | u[1] | u[2] | u[3])
+			& (all_clear | all_mines);
+	}
+}
@@ -0,0 +1,63 @@
+#ifndef MINESWEEPER_SOLVER_BITBOARD_H
+#define MINESWEEPER_SOLVER_BITBOARD_H
+
+#include <stdint.h>
+
+#include "board.h"
+
+/* Bit-plane copy of a board. Every plane holds one bit per tile, 64 tiles of
+ * a row per word, lowest bit being the leftmost tile. Rows are padded with an
+ * empty word on either side and the plane with an empty row above and below,
+ * so kernels can look at neighbors without any bounds checks.
+ * */
+struct bitboard {
+	int rows;
+	int cols;
+	int words;	/* Words holding one row */
+	int stride;	/* Words between the starts of two rows */
+
+	/* Raw tile bits */
+	uint64_t *mine;
+	uint64_t *unknown;
+	uint64_t *deduced;
+
+	/* Unknown tiles not yet deduced and mines that are known or deduced,
+	 * i.e. what the deduction rules care about.
+	 * */
+	uint64_t *open;
+	uint64_t *known_mine;
+
+	/* Numbered tiles and their values, bit-sliced: bit k of the number is
+	 * in number[k].
+	 * */
+	uint64_t *numbered;
+	uint64_t *number[4];
+
+	uint64_t *storage;
+};
+
+#define BITBOARD_ROW(__bb, __plane, __row)	\
+	((__plane) + ((__row) + 1) * (__bb)->stride + 1)
+
+int bitboard_init(struct bitboard *bb, int rows, int cols);
+void bitboard_destroy(struct bitboard *bb);
+void bitboard_from_board(struct bitboard *bb, const struct minesweeper_board *board);
+
+void bitboard_count_row(const struct bitboard *bb, const uint64_t *plane, int row, uint64_t *count);
+void bitboard_simple_rules(const struct bitboard *bb, int row, uint64_t *scratch, uint64_t *fires);
+
+/* Pulls the neighbor count of one tile out of a bit-sliced count produced by
+ * bitboard_count_row().
+ * */
+static inline int bitboard_count_at(const uint64_t *count, int words, int col)
+{
+	int w = col / 64;
+	int b = col % 64;
+
+	return (int)((count[w] >> b) & 1)
+		| (int)((count[words + w] >> b) & 1) << 1
+		| (int)((count[2 * words + w] >> b) & 1) << 2
+		| (int)((count[3 * words + w] >> b) & 1) << 3;
+}
+
+#endif /* MINESWEEPER_SOLVER_BITBOARD_H */
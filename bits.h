@@ -5,6 +5,9 @@
 
 static inline int popcount(uintmax_t n)
 {
+#if defined(__GNUC__)
+	return __builtin_popcountll(n);
+#else
 	int ret = 0;
 
 	while (n) {
@@ -13,6 +16,24 @@ static inline int popcount(uintmax_t n)
 	}
 
 	return ret;
+#endif
+}
+
+/* Index of the lowest set bit. n must not be 0. */
+static inline int lowest_bit(uint64_t n)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(n);
+#else
+	int ret = 0;
+
+	while (!(n & 1)) {
+		ret++;
+		n >>= 1;
+	}
+
+	return ret;
+#endif
 }
 
 #endif /* MINESWEEPER_SOLVER_BITS_H */
@@ -1,51 +1,199 @@
-#include <string.h>
+#define _POSIX_C_SOURCE 200809L
 
-#include <gramas/buf.h>
-#include <gramas/line_reader.h>
+#include <limits.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
+#include "arena.h"
+#include "bitboard.h"
 #include "bits.h"
 #include "board.h"
+#include "buf.h"
+#include "cache.h"
 #include "combine.h"
+#include "frontier.h"
+#include "layout_counts.h"
+#include "stats.h"
+#include "tile_strings.h"
+#include "worklist.h"
 
 #ifndef BOARD_DEBUG
 #	define BOARD_DEBUG 0
 #endif
 
+/* Tiles are rendered into a chunk this big on the stack before going into the
+ * output buffer
+ * */
+#define BOARD_OUTPUT_CHUNK	4096
+
+/* Binary corpora, all numbers little endian:
+ *
+ *	header		"MSSB", u16 version, u16 0
+ *	board...	u32 rows, u32 cols, i32 mines or -1, u32 0, then one
+ *			nibble per tile, row by row, low nibble first
+ *	index		u64 file offset of every board
+ *	trailer		u64 offset of the index, u64 boards, "MSSE", u32 version
+ *
+ * Nibbles 0 to 8 are numbers, then come a mine and an unknown tile. The
+ * index goes at the end so that corpora can be written as a stream.
+ * */
+#define BOARD_BIN_HEADER	8
+#define BOARD_BIN_RECORD	16
+#define BOARD_BIN_TRAILER	24
+#define BOARD_BIN_MINE		9
+#define BOARD_BIN_UNKNOWN	10
+
+/* Input that cannot be mapped is read in blocks of this size */
+#define BOARD_READ_BLOCK	(1 << 20)
+
+/* Tile each input character stands for, plus one. 0 for characters that are
+ * not tiles and get skipped.
+ * */
+static const unsigned char tile_from_char[256] = {
+	['?'] = TILE_UNKNOWN + 1,
+	['.'] = TILE_CLEAR + 1,
+	['#'] = TILE_MINE + 1,
+	['1'] = 1 + 1,
+	['2'] = 2 + 1,
+	['3'] = 3 + 1,
+	['4'] = 4 + 1,
+	['5'] = 5 + 1,
+	['6'] = 6 + 1,
+	['7'] = 7 + 1,
+	['8'] = 8 + 1,
+};
+
+/* The same classification 16 characters at a time. __builtin_shuffle is what
+ * splits spaced out tiles from their separators, hence GCC only.
+ * */
+#if defined(__GNUC__) && !defined(__clang__) && !defined(BOARD_NO_SIMD)
+#	define BOARD_CHAR_LANES 16
+typedef unsigned char board_chars __attribute__((vector_size(BOARD_CHAR_LANES)));
+
+/* 0xFF in lanes holding a tile character, 0 elsewhere */
+static inline board_chars chars_are_tiles(board_chars c)
+{
+	return (board_chars)((c == '?') | (c == '.') | (c == '#') | ((board_chars)(c - '1') < 8));
+}
+
+/* Only meaningful in lanes holding a tile character */
+static inline board_chars chars_to_tiles(board_chars c)
+{
+	board_chars digit = c - '0';
+
+	return (digit & (board_chars)((board_chars)(digit - 1) < 8))
+		| ((board_chars)(c == '?') & TILE_UNKNOWN)
+		| ((board_chars)(c == '#') & TILE_MINE);
+}
+#endif
+
+/* Set once up front, before any board gets printed */
+static int board_color = 1;
+
+/* Adds to a counter of board->stats, if there is one */
+#define BOARD_COUNT(__board, __counter, __n)				\
+	do {								\
+		if ((__board)->stats)					\
+			(__board)->stats->__counter += (__n);		\
+	} while (0)
+
+static void board_alloc(struct minesweeper_board *board, int row_capacity, int col_capacity);
+static int board_bin_put(struct board_bin_writer *writer, const void *data, size_t length);
+static void put_u32(unsigned char *dst, uint32_t n);
+static void put_u64(unsigned char *dst, uint64_t n);
+static uint32_t get_u32(const unsigned char *src);
+static uint64_t get_u64(const unsigned char *src);
 static void board_reveal_neighbors_clear(struct minesweeper_board *board, int row, int col);
 static void board_reveal_neighbors_mines(struct minesweeper_board *board, int row, int col);
 static int board_deduce_from_tile(struct minesweeper_board *board, int row, int col);
+static int board_deduce_frontier_cases(struct minesweeper_board *board, int reveal);
 static int board_deduce_guaranteed_cases(struct minesweeper_board *board);
 static int board_deduce_partial_cases(struct minesweeper_board *board);
 static int board_deduce_partial_from_tile(struct minesweeper_board *board, int row, int col);
+static int board_deduce_pair_cases(struct minesweeper_board *board);
+static int board_deduce_pairs_from_tile(struct minesweeper_board *board, int row, int col);
+static int board_deduce_window_from_tile(struct minesweeper_board *board, int row, int col);
 static void board_fill_empty_tiles(struct minesweeper_board *board, int row, int col);
 static int board_is_solved(struct minesweeper_board *board);
+static void board_queue_neighbors(const struct minesweeper_board *board, int row, int col);
+static void board_queue_numbers(struct minesweeper_board *board);
+static void board_queue_simple_cases(struct minesweeper_board *board);
+static void board_read_line(struct minesweeper_board *board, int row, const char *line, size_t length);
+static int board_count_tile_chars(const unsigned char *chars, size_t length);
+static char *board_read_blocks(FILE *file, size_t *length);
+static const char *board_map_rest(FILE *file, size_t *length, void **handle, size_t *handle_size);
+static void board_unmap(void *handle, size_t handle_size);
 static void board_resize_if_needed(struct minesweeper_board *board, int row, int col);
 static void board_set_deduced_as_known(struct minesweeper_board *board);
 static int board_solve_from_tile(struct minesweeper_board *board, int row, int col);
 static int board_solve_iteration(struct minesweeper_board *board);
-static int tile_to_string(const unsigned char tile, struct gr_buffer *strbuf);
+static int board_deduce_stage(struct minesweeper_board *board, enum board_stage stage);
+static void board_count_stage(struct minesweeper_board *board, enum board_stage stage,
+		int deduced, uint64_t start);
+static void *board_scratch_alloc(struct minesweeper_board *board, size_t size,
+		struct arena_mark *mark);
+static void board_scratch_free(struct minesweeper_board *board, void *ptr,
+		const struct arena_mark *mark);
 
 void board_init(struct minesweeper_board *board, int rows, int cols)
 {
+	int i;
+	int row_capacity = 1;
+	int col_capacity = 1;
+
+	while (row_capacity < rows)
+		row_capacity *= 2;
+
+	while (col_capacity < cols)
+		col_capacity *= 2;
+
 	board->rows = rows;
 	board->cols = cols;
+	board->worklist = NULL;
+	board->cache = NULL;
+	board->jobs = 0;
+	board->pipeline = NULL;
+	board->stats = NULL;
+	board->arena = NULL;
+	board_alloc(board, row_capacity, col_capacity);
 
-	board->row_capacity = 1;
-	board->col_capacity = 1;
+	for (i = 0; i < board->rows; i++)
+		memset(&BOARD_AT(board, i, 0), TILE_UNKNOWN, board->cols);
+}
 
-	while (board->row_capacity < board->rows)
-		board->row_capacity *= 2;
+void board_destroy(struct minesweeper_board *board)
+{
+	free(board->storage);
+}
+
+/* Tiles only. dst gets no worklist, cache, pipeline, stats or arena. */
+void board_copy(struct minesweeper_board *dst, const struct minesweeper_board *src)
+{
+	int i;
 
-	while (board->col_capacity < board->cols)
-		board->col_capacity *= 2;
+	board_init(dst, src->rows, src->cols);
 
-	board->tiles = malloc(board->row_capacity * board->col_capacity * sizeof(board->tiles[0]));
-	memset(board->tiles, TILE_UNKNOWN, board->row_capacity * board->col_capacity * sizeof(board->tiles[0]));
+	for (i = 0; i < src->rows; i++)
+		memcpy(&BOARD_AT(dst, i, 0), &BOARD_AT(src, i, 0), src->cols);
 }
 
-void board_destroy(struct minesweeper_board *board)
+/* Allocates tile storage, border included, with everything set to
+ * TILE_OUTSIDE.
+ * */
+static void board_alloc(struct minesweeper_board *board, int row_capacity, int col_capacity)
 {
-	free(board->tiles);
+	size_t size;
+
+	board->row_capacity = row_capacity;
+	board->col_capacity = col_capacity;
+	board->stride = col_capacity + 2 * BOARD_PADDING;
+
+	size = (size_t)(row_capacity + 2 * BOARD_PADDING) * board->stride;
+	board->storage = malloc(size * sizeof(board->storage[0]));
+	memset(board->storage, TILE_OUTSIDE, size * sizeof(board->storage[0]));
+
+	board->tiles = board->storage + BOARD_PADDING * board->stride + BOARD_PADDING;
 }
 
 void board_set_r(struct minesweeper_board *board, int row, int col, unsigned char state)
@@ -54,44 +202,48 @@ void board_set_r(struct minesweeper_board *board, int row, int col, unsigned cha
 	BOARD_AT(board, row, col) = state;
 }
 
+/* Tiles that end up inside the board after growing it start out unknown.
+ * Everything past the new edge stays TILE_OUTSIDE.
+ * */
 static void board_resize_if_needed(struct minesweeper_board *board, int row, int col)
 {
+	struct minesweeper_board old;
 	int new_col_cap;
 	int new_row_cap;
-	unsigned char *new_board;
+	int new_rows;
+	int new_cols;
 	int i;
-	int j;
 
 	if (row < board->rows && col < board->cols)
 		return;
 
-	if (row < board->row_capacity && row >= board->rows)
-		board->rows = row + 1;
-
-	if (col < board->col_capacity && col >= board->cols)
-		board->cols = col + 1;
+	new_rows = row < board->rows ? board->rows : row + 1;
+	new_cols = col < board->cols ? board->cols : col + 1;
 
-	if (col >= board->col_capacity || row >= board->row_capacity) {
+	if (new_cols > board->col_capacity || new_rows > board->row_capacity) {
 		new_col_cap = board->col_capacity;
 		new_row_cap = board->row_capacity;
 
-		while (new_col_cap <= col) new_col_cap *= 2;
-		while (new_row_cap <= row) new_row_cap *= 2;
+		while (new_col_cap < new_cols) new_col_cap *= 2;
+		while (new_row_cap < new_rows) new_row_cap *= 2;
 
-		new_board = malloc(new_col_cap * new_row_cap * sizeof(new_board[0]));
+		old = *board;
+		board_alloc(board, new_row_cap, new_col_cap);
 
 		for (i = 0; i < board->rows; i++)
-			for (j = 0; j < board->cols; j++)
-				new_board[i * new_col_cap + j] = BOARD_AT(board, i, j);
-
-		free(board->tiles);
-		board->tiles = new_board;
-		board->col_capacity = new_col_cap;
-		board->row_capacity = new_row_cap;
+			memcpy(&BOARD_AT(board, i, 0), &BOARD_AT(&old, i, 0), board->cols);
 
-		if (col >= board->cols) board->cols = col + 1;
-		if (row >= board->rows) board->rows = row + 1;
+		free(old.storage);
 	}
+
+	for (i = 0; i < board->rows; i++)
+		memset(&BOARD_AT(board, i, board->cols), TILE_UNKNOWN, new_cols - board->cols);
+
+	for (; i < new_rows; i++)
+		memset(&BOARD_AT(board, i, 0), TILE_UNKNOWN, new_cols);
+
+	board->rows = new_rows;
+	board->cols = new_cols;
 }
 
 int board_is_full(const struct minesweeper_board *board)
@@ -148,6 +300,7 @@ int board_mine_numbers_consistent(const struct minesweeper_board *board)
 			neighbors = 0;
 
 			BOARD_FOREACH_NEIGHBOR(board, i, j, k, l, tile) {
+				if (*tile == TILE_OUTSIDE) continue;
 				if (*tile & TILE_MINE) mine_count++;
 				neighbors++;
 			}
@@ -160,62 +313,295 @@ int board_mine_numbers_consistent(const struct minesweeper_board *board)
 	return 1;
 }
 
+/* Mines around a tile, known or not, i.e. the number a full board would
+ * reveal there
+ * */
+int board_count_neighbor_mines(const struct minesweeper_board *board, int row, int col)
+{
+	int ret = 0;
+	int i;
+	int j;
+	unsigned char *tile;
+
+	BOARD_FOREACH_NEIGHBOR(board, row, col, i, j, tile)
+		if (*tile & TILE_MINE)
+			ret++;
+
+	return ret;
+}
+
+/* The text is parsed in one go, see board_map_rest() */
 void board_read(struct minesweeper_board *board, FILE *file)
 {
-	struct file_line_itr_s itr = {0};
-	const char *line = NULL;
-	size_t length = 0;
-	size_t i = 0;
+	const char *text;
+	void *handle;
+	size_t handle_size;
+	size_t length;
+
+	text = board_map_rest(file, &length, &handle, &handle_size);
+	board_read_buf(board, text ? text : "", text ? length : 0);
+	board_unmap(handle, handle_size);
+}
+
+/* Gets hold of everything left in file. Regular files are mapped into memory,
+ * anything else is read in large blocks. What ends up in *handle and
+ * *handle_size is for board_unmap().
+ * */
+static const char *board_map_rest(FILE *file, size_t *length, void **handle, size_t *handle_size)
+{
+	struct stat st;
+	void *map;
+	off_t offset;
+
+	offset = ftello(file);
+
+	if (offset >= 0 && !fstat(fileno(file), &st) && S_ISREG(st.st_mode) && st.st_size > offset) {
+		map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(file), 0);
+
+		if (map != MAP_FAILED) {
+			fseeko(file, 0, SEEK_END);
+			*length = st.st_size - offset;
+			*handle = map;
+			*handle_size = st.st_size;
+			return (const char *)map + offset;
+		}
+	}
+
+	*handle = board_read_blocks(file, length);
+	*handle_size = 0;
+
+	return *handle;
+}
+
+static void board_unmap(void *handle, size_t handle_size)
+{
+	if (handle_size)
+		munmap(handle, handle_size);
+	else
+		free(handle);
+}
+
+static char *board_read_blocks(FILE *file, size_t *length)
+{
+	char *text = NULL;
+	char *grown;
+	size_t capacity = 0;
+	size_t got;
+
+	*length = 0;
+
+	do {
+		if (capacity - *length < BOARD_READ_BLOCK) {
+			capacity = capacity ? capacity * 2 : BOARD_READ_BLOCK;
+			grown = realloc(text, capacity);
+
+			if (!grown) {
+				free(text);
+				return NULL;
+			}
+
+			text = grown;
+		}
+
+		got = fread(text + *length, 1, capacity - *length, file);
+		*length += got;
+	} while (got);
+
+	return text;
+}
+
+/* Same as board_read() but takes the text from memory. The first pass only
+ * works out the size of the board, so that tiles can be written straight
+ * into their place by the second.
+ * */
+void board_read_buf(struct minesweeper_board *board, const char *text, size_t length)
+{
+	const char *end = text + length;
+	const char *line;
+	const char *eol;
+	int rows = 1;
+	int cols = 1;
 	int row = 0;
-	int col = 0;
+	int n;
+
+	for (line = text; line < end; line = eol + 1, row++) {
+		eol = memchr(line, '\n', end - line);
+
+		if (!eol)
+			eol = end;
+
+		n = board_count_tile_chars((const unsigned char *)line, eol - line);
+
+		if (n) {
+			rows = row + 1;
+			cols = n > cols ? n : cols;
+		}
+	}
+
+	board_init(board, rows, cols);
+
+	for (line = text, row = 0; line < end && row < rows; line = eol + 1, row++) {
+		eol = memchr(line, '\n', end - line);
+
+		if (!eol)
+			eol = end;
+
+		board_read_line(board, row, line, eol - line);
+	}
+}
+
+/* Boards are nearly always written with a single space between tiles, so
+ * that layout is tried first: every even character is taken as a tile and
+ * the guess checked along the way. Anything else goes through the general
+ * loop, which writes every character to the next tile but only moves on if it
+ * was one, leaving at most the tile just past the last one to clean up.
+ * */
+static void board_read_line(struct minesweeper_board *board, int row, const char *line, size_t length)
+{
+	const unsigned char *chars = (const unsigned char *)line;
+	unsigned char *tiles = &BOARD_AT(board, row, 0);
 	unsigned char tile;
+	size_t half = length / 2;
+	size_t i = 0;
+	int spaced = (length + 1) / 2 <= (size_t)board->cols;
+	int col = 0;
+
+#ifdef BOARD_CHAR_LANES
+	const board_chars evens = { 0, 2, 4, 6, 8, 10, 12, 14, 16, 18, 20, 22, 24, 26, 28, 30 };
+	const board_chars odds = evens + 1;
+	board_chars bad = { 0 };
+	board_chars lo;
+	board_chars hi;
+	board_chars even;
+	board_chars odd;
+#endif
+
+	if (spaced) {
+#ifdef BOARD_CHAR_LANES
+		for (; i + BOARD_CHAR_LANES <= half; i += BOARD_CHAR_LANES) {
+			memcpy(&lo, chars + 2 * i, BOARD_CHAR_LANES);
+			memcpy(&hi, chars + 2 * i + BOARD_CHAR_LANES, BOARD_CHAR_LANES);
+			even = __builtin_shuffle(lo, hi, evens);
+			odd = __builtin_shuffle(lo, hi, odds);
+
+			bad |= ~chars_are_tiles(even) | chars_are_tiles(odd);
+			even = chars_to_tiles(even);
+			memcpy(tiles + i, &even, BOARD_CHAR_LANES);
+		}
 
-	board_init(board, 1, 1);
+		for (col = 0; col < BOARD_CHAR_LANES; col++)
+			spaced &= !bad[col];
 
-	FOREACH_LINE_IN_FILE(&itr, file, &line, &length) {
+		col = 0;
+#endif
+
+		for (; i < half; i++) {
+			tile = tile_from_char[chars[2 * i]];
+			tiles[i] = tile - 1;
+			spaced &= (tile != 0) & (tile_from_char[chars[2 * i + 1]] == 0);
+		}
+
+		if (length % 2) {
+			tile = tile_from_char[chars[length - 1]];
+			tiles[half] = tile - 1;
+			spaced &= tile != 0;
+		}
+
+		if (spaced)
+			col = (length + 1) / 2;
+	}
+
+	if (!spaced) {
 		for (i = 0; i < length; i++) {
-			if (line[i] == '?') {
-				tile = TILE_UNKNOWN;
-			} else if (line[i] == '.') {
-				tile = TILE_CLEAR;
-			} else if (line[i] == '#') {
-				tile = TILE_MINE;
-			} else if (line[i] >= '1' && line[i] <= '8') {
-				tile = line[i] - '0';
-			} else {
-				continue;
-			}
+			tile = tile_from_char[chars[i]];
+			tiles[col] = tile - 1;
+			col += tile != 0;
+		}
+	}
+
+	if (col < board->cols)
+		memset(&tiles[col], TILE_UNKNOWN, board->cols - col);
+	else
+		tiles[col] = TILE_OUTSIDE;
+}
+
+static int board_count_tile_chars(const unsigned char *chars, size_t length)
+{
+	size_t i = 0;
+	int ret = 0;
+
+#ifdef BOARD_CHAR_LANES
+	board_chars count;
+	board_chars c;
+	int k;
 
-			board_set_r(board, row, col++, tile);
+	/* Lanes count up by one per tile, so they are emptied before they
+	 * can wrap around.
+	 * */
+	while (i + BOARD_CHAR_LANES <= length) {
+		count = (board_chars){ 0 };
+
+		for (k = 0; k < 255 && i + BOARD_CHAR_LANES <= length; k++, i += BOARD_CHAR_LANES) {
+			memcpy(&c, chars + i, BOARD_CHAR_LANES);
+			count -= chars_are_tiles(c);
 		}
 
-		row++;
-		col = 0;
+		for (k = 0; k < BOARD_CHAR_LANES; k++)
+			ret += count[k];
 	}
+#endif
+
+	for (; i < length; i++)
+		ret += tile_from_char[chars[i]] != 0;
+
+	return ret;
+}
 
-	file_line_itr_delete(&itr);
+/* Printing with or without ANSI colors. Only the colors tell tiles deduced or
+ * found to be wrong apart from the rest.
+ * */
+void board_set_color(int color)
+{
+	board_color = !!color;
 }
 
+/* Whole table entries are copied, so a chunk is passed on once it no longer
+ * has room for one more after the newline.
+ * */
 int board_to_string_buf(const struct minesweeper_board *board, struct gr_buffer *strbuf)
 {
+	const unsigned char *lengths = tile_string_lengths[board_color];
+	const char (*strings)[TILE_STRING_SIZE] = tile_strings[board_color];
+	char chunk[BOARD_OUTPUT_CHUNK];
+	size_t used = 0;
+	unsigned char tile;
 	int i;
 	int j;
-	int ret = 0;
 
 	for (i = 0; i < board->rows; i++) {
 		for (j = 0; j < board->cols; j++) {
-			if (tile_to_string(BOARD_AT(board, i, j), strbuf)) {
+			tile = BOARD_AT(board, i, j);
+
+			if (!lengths[tile]) {
 				fprintf(stderr, "Unknown tile %i,%i!\n", i, j);
 				exit(1);
 			}
 
-			gr_buf_append_char(strbuf, ' ');
+			memcpy(chunk + used, strings[tile], TILE_STRING_SIZE);
+			used += lengths[tile];
+
+			if (used > BOARD_OUTPUT_CHUNK - TILE_STRING_SIZE - 1) {
+				gr_buf_append(strbuf, chunk, used);
+				used = 0;
+			}
 		}
 
-		gr_buf_append_char(strbuf, '\n');
+		chunk[used++] = '\n';
 	}
 
-	return ret;
+	gr_buf_append(strbuf, chunk, used);
+
+	return 0;
 }
 
 int board_print(const struct minesweeper_board *board, FILE *out)
@@ -231,139 +617,459 @@ int board_print(const struct minesweeper_board *board, FILE *out)
 	return ret;
 }
 
-#define BOLD(__str) "\033[1m" __str "\033[0m"
-#define COLOR(__r, __g, __b, __str) "\033[38;2;" #__r ";" #__g ";" #__b "m" __str "\033[0m"
+int board_bin_writer_init(struct board_bin_writer *writer, FILE *out)
+{
+	unsigned char header[BOARD_BIN_HEADER] = { 'M', 'S', 'S', 'B', BOARD_BIN_VERSION, 0, 0, 0 };
 
-static int tile_to_string(const unsigned char tile, struct gr_buffer *strbuf)
+	memset(writer, 0, sizeof(*writer));
+	writer->out = out;
+
+	return board_bin_put(writer, header, sizeof(header));
+}
+
+/* Deduced tiles are written as what they were deduced to be. Tiles found to
+ * be wrong cannot be written.
+ * */
+int board_bin_write(struct board_bin_writer *writer, const struct minesweeper_board *board, int mines)
 {
-	const char *str = NULL;
+	unsigned char chunk[BOARD_OUTPUT_CHUNK];
+	unsigned char nibble;
+	unsigned char tile;
+	uint64_t *grown;
+	size_t used = BOARD_BIN_RECORD;
+	size_t capacity;
+	int half = 0;
+	int i;
+	int j;
 
-	if (tile & TILE_BUGGERED) {
-		switch (tile & ~(TILE_DEDUCED | TILE_UNKNOWN | TILE_BUGGERED)) {
-		case TILE_CLEAR: str = BOLD(COLOR(255, 0, 0, ".")); break;
-		case 1: str = BOLD(COLOR(255, 0, 0, "1")); break;
-		case 2: str = BOLD(COLOR(255, 0, 0, "2")); break;
-		case 3: str = BOLD(COLOR(255, 0, 0, "3")); break;
-		case 4: str = BOLD(COLOR(255, 0, 0, "4")); break;
-		case 5: str = BOLD(COLOR(255, 0, 0, "5")); break;
-		case 6: str = BOLD(COLOR(255, 0, 0, "6")); break;
-		case 7: str = BOLD(COLOR(255, 0, 0, "7")); break;
-		case 8: str = BOLD(COLOR(255, 0, 0, "8")); break;
-		case TILE_MINE: str = BOLD(COLOR(255, 0, 0, "#")); break;
-		}
-	} else if (tile & TILE_DEDUCED) {
-		switch (tile & ~(TILE_DEDUCED | TILE_UNKNOWN)) {
-		case TILE_CLEAR: str = COLOR(255, 255, 0, "."); break;
-		case 1: str = COLOR(255, 255, 0, "1"); break;
-		case 2: str = COLOR(255, 255, 0, "2"); break;
-		case 3: str = COLOR(255, 255, 0, "3"); break;
-		case 4: str = COLOR(255, 255, 0, "4"); break;
-		case 5: str = COLOR(255, 255, 0, "5"); break;
-		case 6: str = COLOR(255, 255, 0, "6"); break;
-		case 7: str = COLOR(255, 255, 0, "7"); break;
-		case 8: str = COLOR(255, 255, 0, "8"); break;
-		case TILE_MINE: str = COLOR(255, 255, 0, "#"); break;
+	if (writer->n_boards == writer->capacity) {
+		capacity = writer->capacity ? writer->capacity * 2 : 64;
+		grown = realloc(writer->offsets, capacity * sizeof(writer->offsets[0]));
+
+		if (!grown)
+			return 1;
+
+		writer->offsets = grown;
+		writer->capacity = capacity;
+	}
+
+	writer->offsets[writer->n_boards++] = writer->offset;
+
+	put_u32(chunk, board->rows);
+	put_u32(chunk + 4, board->cols);
+	put_u32(chunk + 8, (uint32_t)mines);
+	put_u32(chunk + 12, 0);
+
+	for (i = 0; i < board->rows; i++) {
+		for (j = 0; j < board->cols; j++) {
+			tile = BOARD_AT(board, i, j);
+
+			if ((tile & (TILE_UNKNOWN | TILE_DEDUCED | TILE_BUGGERED)) == TILE_UNKNOWN)
+				nibble = BOARD_BIN_UNKNOWN;
+			else if (tile & TILE_BUGGERED)
+				return 1;
+			else if (TILE_IS_MINE(tile))
+				nibble = BOARD_BIN_MINE;
+			else
+				nibble = TILE_NEIGHBOR_MINES(tile);
+
+			if (half) {
+				chunk[used++] |= nibble << 4;
+			} else {
+				if (used == sizeof(chunk)) {
+					if (board_bin_put(writer, chunk, used))
+						return 1;
+
+					used = 0;
+				}
+
+				chunk[used] = nibble;
+			}
+
+			half = !half;
 		}
-	} else if (tile & TILE_UNKNOWN) {
-		str = COLOR(0, 0, 255, "?");
-	} else {
-		switch (tile) {
-		case TILE_CLEAR: str = COLOR(40, 40, 40, "."); break;
-		case 1: str = COLOR(60, 255, 0, "1"); break;
-		case 2: str = COLOR(120, 255, 0, "2"); break;
-		case 3: str = COLOR(180, 255, 0, "3"); break;
-		case 4: str = COLOR(255, 255, 0, "4"); break;
-		case 5: str = COLOR(255, 180, 0, "5"); break;
-		case 6: str = COLOR(255, 120, 0, "6"); break;
-		case 7: str = COLOR(255, 60, 0, "7"); break;
-		case 8: str = COLOR(255, 0, 0, "8"); break;
-		case TILE_MINE: str = COLOR(255, 0, 0, "#"); break;
+	}
+
+	return board_bin_put(writer, chunk, used + half);
+}
+
+/* Writes the index and frees what the writer had. The output is left open. */
+int board_bin_writer_finish(struct board_bin_writer *writer)
+{
+	unsigned char trailer[BOARD_BIN_TRAILER];
+	unsigned char offset[8];
+	uint64_t index = writer->offset;
+	size_t i;
+	int ret = 0;
+
+	for (i = 0; i < writer->n_boards && !ret; i++) {
+		put_u64(offset, writer->offsets[i]);
+		ret = board_bin_put(writer, offset, sizeof(offset));
+	}
+
+	put_u64(trailer, index);
+	put_u64(trailer + 8, writer->n_boards);
+	memcpy(trailer + 16, "MSSE", 4);
+	put_u32(trailer + 20, BOARD_BIN_VERSION);
+
+	if (!ret)
+		ret = board_bin_put(writer, trailer, sizeof(trailer));
+
+	free(writer->offsets);
+	memset(writer, 0, sizeof(*writer));
+
+	return ret;
+}
+
+static int board_bin_put(struct board_bin_writer *writer, const void *data, size_t length)
+{
+	if (fwrite(data, 1, length, writer->out) != length)
+		return 1;
+
+	writer->offset += length;
+
+	return 0;
+}
+
+/* Only checks the header and the index. Boards are checked as they are
+ * read. data has to outlive bin.
+ * */
+int board_bin_open(struct board_bin *bin, const void *data, size_t size)
+{
+	const unsigned char *bytes = data;
+	const unsigned char *trailer;
+	uint64_t index;
+	uint64_t n_boards;
+
+	memset(bin, 0, sizeof(*bin));
+
+	if (size < BOARD_BIN_HEADER + BOARD_BIN_TRAILER)
+		return 1;
+
+	trailer = bytes + size - BOARD_BIN_TRAILER;
+	index = get_u64(trailer);
+	n_boards = get_u64(trailer + 8);
+
+	if (memcmp(bytes, "MSSB", 4) || bytes[4] != BOARD_BIN_VERSION
+			|| memcmp(trailer + 16, "MSSE", 4) || get_u32(trailer + 20) != BOARD_BIN_VERSION)
+		return 1;
+
+	if (index < BOARD_BIN_HEADER || index > size - BOARD_BIN_TRAILER
+			|| n_boards != (size - BOARD_BIN_TRAILER - index) / 8
+			|| (size - BOARD_BIN_TRAILER - index) % 8)
+		return 1;
+
+	bin->data = bytes;
+	bin->size = index;
+	bin->index = bytes + index;
+	bin->n_boards = n_boards;
+
+	return 0;
+}
+
+/* Same as board_bin_open() but on everything left in file */
+int board_bin_load(struct board_bin *bin, FILE *file)
+{
+	const char *data;
+	void *handle;
+	size_t handle_size;
+	size_t length;
+
+	data = board_map_rest(file, &length, &handle, &handle_size);
+
+	if (!data || board_bin_open(bin, data, length)) {
+		board_unmap(handle, handle_size);
+		return 1;
+	}
+
+	bin->handle = handle;
+	bin->handle_size = handle_size;
+
+	return 0;
+}
+
+void board_bin_close(struct board_bin *bin)
+{
+	if (bin->handle)
+		board_unmap(bin->handle, bin->handle_size);
+
+	memset(bin, 0, sizeof(*bin));
+}
+
+/* Reads board number i. mines may be NULL. */
+int board_bin_read(const struct board_bin *bin, uint64_t i, struct minesweeper_board *board, int *mines)
+{
+	static const unsigned char tile_from_nibble[16] = {
+		0, 1, 2, 3, 4, 5, 6, 7, 8, TILE_MINE, TILE_UNKNOWN,
+		TILE_OUTSIDE, TILE_OUTSIDE, TILE_OUTSIDE, TILE_OUTSIDE, TILE_OUTSIDE
+	};
+	const unsigned char *record;
+	const unsigned char *nibbles;
+	unsigned char bad = 0;
+	unsigned char *tiles;
+	uint64_t offset;
+	uint64_t rows;
+	uint64_t cols;
+	uint64_t n;
+	int row;
+	int col;
+
+	if (i >= bin->n_boards)
+		return 1;
+
+	offset = get_u64(bin->index + 8 * i);
+
+	if (offset < BOARD_BIN_HEADER || offset > bin->size || bin->size - offset < BOARD_BIN_RECORD)
+		return 1;
+
+	record = bin->data + offset;
+	rows = get_u32(record);
+	cols = get_u32(record + 4);
+
+	if (!rows || !cols || rows > INT_MAX || cols > INT_MAX
+			|| (rows * cols + 1) / 2 > bin->size - offset - BOARD_BIN_RECORD)
+		return 1;
+
+	if (mines)
+		*mines = (int32_t)get_u32(record + 8);
+
+	board_init(board, rows, cols);
+	nibbles = record + BOARD_BIN_RECORD;
+	n = 0;
+
+	for (row = 0; row < board->rows; row++) {
+		tiles = &BOARD_AT(board, row, 0);
+
+		for (col = 0; col < board->cols; col++, n++) {
+			tiles[col] = tile_from_nibble[(nibbles[n / 2] >> (n % 2 * 4)) & 0xF];
+			bad |= tiles[col] == TILE_OUTSIDE;
 		}
 	}
 
-	if (str == NULL) {
+	if (bad) {
+		board_destroy(board);
 		return 1;
 	}
 
-	gr_buf_append(strbuf, str, strlen(str));
 	return 0;
 }
 
-int board_solve_full(struct minesweeper_board *board, int row, int col)
+static void put_u32(unsigned char *dst, uint32_t n)
+{
+	int i;
+
+	for (i = 0; i < 4; i++)
+		dst[i] = n >> (8 * i);
+}
+
+static void put_u64(unsigned char *dst, uint64_t n)
+{
+	put_u32(dst, (uint32_t)n);
+	put_u32(dst + 4, (uint32_t)(n >> 32));
+}
+
+static uint32_t get_u32(const unsigned char *src)
+{
+	return src[0] | (uint32_t)src[1] << 8 | (uint32_t)src[2] << 16 | (uint32_t)src[3] << 24;
+}
+
+static uint64_t get_u64(const unsigned char *src)
+{
+	return get_u32(src) | (uint64_t)get_u32(src + 4) << 32;
+}
+
+int board_solve_full(struct minesweeper_board *board, int row, int col, struct gr_buffer *out)
 {
 	int ret = BOARD_SOLVE_SUCCESS;
-	struct gr_buffer strbuf;
+	struct board_worklist worklist;
+	struct board_arena arena;
+	struct arena_mark mark;
+	struct bitboard bb;
+	uint64_t *counts;
+	char number[2] = { '0', ' ' };
+	int own_arena = 0;
 	int i = 0;
 	int j = 0;
-	int k;
-	int l;
-	unsigned char *tile;
-	unsigned char mines;
 
-	gr_buf_init(&strbuf, 64);
+	if (bitboard_init(&bb, board->rows, board->cols))
+		return BOARD_SOLVE_BUG;
+
+	if (!board->arena) {
+		arena_init(&arena);
+		board->arena = &arena;
+		own_arena = 1;
+	}
+
+	counts = board_scratch_alloc(board, 4 * bb.words * sizeof(counts[0]), &mark);
+
+	if (!counts || worklist_init(&worklist, board->rows, board->cols)) {
+		if (counts)
+			board_scratch_free(board, counts, &mark);
+
+		bitboard_destroy(&bb);
+		ret = BOARD_SOLVE_BUG;
+		goto release;
+	}
 
 	for (i = 0; i < board->rows; i++)
 		for (j = 0; j < board->cols; j++)
-			BOARD_AT(board, row, col) |= TILE_UNKNOWN;
+			BOARD_AT(board, i, j) |= TILE_UNKNOWN;
 
 	BOARD_AT(board, row, col) &= ~TILE_UNKNOWN;
 
+	/* Neighbor mine counts are worked out a whole row at a time */
+	bitboard_from_board(&bb, board);
+
 	for (i = 0; i < board->rows; i++) {
+		bitboard_count_row(&bb, bb.mine, i, counts);
+
 		for (j = 0; j < board->cols; j++) {
 			if (!TILE_IS_CLEAR(BOARD_AT(board, i, j))) {
-				fputs("* ", stdout);
+				BUF_APPEND_STR(out, "* ");
 				continue;
 			}
 
-			mines = 0;
 			BOARD_AT(board, i, j) &= 0xF0;
+			BOARD_AT(board, i, j) |= bitboard_count_at(counts, bb.words, j);
 
-			BOARD_FOREACH_NEIGHBOR(board, i, j, k, l, tile)
-				if (*tile & TILE_MINE) mines++;
-
-			BOARD_AT(board, i, j) |= mines;
-
-			printf("%i ", BOARD_AT(board, i, j) & 0xF);
+			number[0] = '0' + (BOARD_AT(board, i, j) & 0xF);
+			gr_buf_append(out, number, sizeof(number));
 		}
-		puts("");
+
+		gr_buf_append_char(out, '\n');
 	}
 
+	board_scratch_free(board, counts, &mark);
+	bitboard_destroy(&bb);
+
+	board->worklist = &worklist;
+	board_queue_numbers(board);
+	BOARD_COUNT(board, boards, 1);
+
 	i = 0;
 
+	/* Nothing a step allocates outlives it */
 	do {
-		gr_buf_clear(&strbuf);
-		buf_printf(&strbuf, "-- Step #%zu --\n", i);
-		board_to_string_buf(board, &strbuf);
-		buf_write(&strbuf, stdout);
+		arena_reset(board->arena);
+		buf_printf(out, "-- Step #%i --\n", i);
+		board_to_string_buf(board, out);
 		board_set_deduced_as_known(board);
 
-		if (i > board->rows + board->cols) {
+		if (i > board->rows * board->cols) {
 			ret = BOARD_SOLVE_BUG;
 			goto end;
 		}
 
 		i++;
+		BOARD_COUNT(board, steps, 1);
 	} while ((ret = board_solve_iteration(board)) == BOARD_SOLVE_PARTIAL);
 
 end:
-	gr_buf_clear(&strbuf);
-	buf_printf(&strbuf, "-- Step #%zu --\n", i);
-	board_to_string_buf(board, &strbuf);
-	buf_write(&strbuf, stdout);
-	gr_buf_delete(&strbuf);
+	buf_printf(out, "-- Step #%i --\n", i);
+	board_to_string_buf(board, out);
+
+	board->worklist = NULL;
+	worklist_destroy(&worklist);
+
+release:
+	if (own_arena) {
+		board->arena = NULL;
+		arena_destroy(&arena);
+	}
 
 	return ret;
 }
 
+/* Tiles revealed during a step become known once the step is over. Numbered
+ * ones among them can then be used for deductions, so they are queued.
+ * */
 static void board_set_deduced_as_known(struct minesweeper_board *board)
+{
+	int i;
+	int row;
+	int col;
+	struct board_worklist *worklist = board->worklist;
+
+	for (i = 0; i < worklist->n_revealed; i++) {
+		row = worklist->revealed[i] / worklist->cols;
+		col = worklist->revealed[i] % worklist->cols;
+
+		BOARD_AT(board, row, col) &= ~(TILE_DEDUCED | TILE_UNKNOWN);
+
+		if (BOARD_AT(board, row, col) <= 8)
+			worklist_push(worklist, row, col);
+	}
+
+	worklist->n_revealed = 0;
+}
+
+/* Queues every numbered tile on the board. Used to kick off propagation. */
+static void board_queue_numbers(struct minesweeper_board *board)
 {
 	int i;
 	int j;
 
 	for (i = 0; i < board->rows; i++)
 		for (j = 0; j < board->cols; j++)
-			if (BOARD_AT(board, i, j) & TILE_DEDUCED)
-				BOARD_AT(board, i, j) &= ~(TILE_DEDUCED | TILE_UNKNOWN);
+			if (BOARD_AT(board, i, j) <= 8)
+				worklist_push(board->worklist, i, j);
+}
+
+/* Queues only the numbered tiles on which board_deduce_from_tile() is bound
+ * to make progress. Those are picked out a whole row at a time on a bitboard.
+ * Anything else gets queued once its neighborhood changes.
+ * */
+static void board_queue_simple_cases(struct minesweeper_board *board)
+{
+	struct bitboard bb;
+	struct arena_mark mark;
+	uint64_t *scratch;
+	uint64_t *fires;
+	uint64_t word;
+	int i;
+	int w;
+
+	if (bitboard_init(&bb, board->rows, board->cols)) {
+		board_queue_numbers(board);
+		return;
+	}
+
+	scratch = board_scratch_alloc(board, 9 * bb.words * sizeof(scratch[0]), &mark);
+
+	if (!scratch) {
+		bitboard_destroy(&bb);
+		board_queue_numbers(board);
+		return;
+	}
+
+	fires = scratch + 8 * bb.words;
+	bitboard_from_board(&bb, board);
+
+	for (i = 0; i < board->rows; i++) {
+		bitboard_simple_rules(&bb, i, scratch, fires);
+
+		for (w = 0; w < bb.words; w++)
+			for (word = fires[w]; word; word &= word - 1)
+				worklist_push(board->worklist, i, w * 64 + lowest_bit(word));
+	}
+
+	board_scratch_free(board, scratch, &mark);
+	bitboard_destroy(&bb);
+}
+
+/* The neighborhood of every numbered tile around row, col just changed. */
+static void board_queue_neighbors(const struct minesweeper_board *board, int row, int col)
+{
+	int i;
+	int j;
+	unsigned char *tile;
+
+	if (!board->worklist)
+		return;
+
+	BOARD_FOREACH_NEIGHBOR(board, row, col, i, j, tile)
+		if (*tile <= 8)
+			worklist_push(board->worklist, row + i, col + j);
 }
 
 static int board_solve_iteration(struct minesweeper_board *board)
@@ -371,40 +1077,46 @@ static int board_solve_iteration(struct minesweeper_board *board)
 	int i;
 	int j;
 	int deduced_anything = 0;
-	int cont = 1;
-	struct gr_buffer strbuf;
+	int ret;
+	int deduced = board->worklist->n_revealed;
+	uint64_t start = board->stats ? board_stats_now_ns() : 0;
 
-	while (cont) {
-		for (i = 0; i < board->rows; i++) {
-			for (j = 0; j < board->cols; j++) {
-				switch(board_solve_from_tile(board, i, j)) {
-				case BOARD_SOLVE_TILE_SUCCESS:
-					cont = 1;
-					deduced_anything |= 1;
-					break;
-				case BOARD_SOLVE_TILE_NOTHING:
-					cont = 0;
-					break;
-				case BOARD_SOLVE_TILE_ERROR:
-					cont = 0;
-
-					fprintf(stderr, "Buggered %i,%i\n", i, j);
-					BOARD_AT(board, i, j) |= TILE_BUGGERED;
-
-					gr_buf_init(&strbuf, 1024);
-					board_to_string_buf(board, &strbuf);
-					buf_write(&strbuf, stderr);
-					gr_buf_delete(&strbuf);
-
-					return BOARD_SOLVE_BUG;
-				}
-			}
+	/* Only tiles whose surroundings changed since they were last looked at
+	 * can yield anything new. Keep going until none are left.
+	 * */
+	while (worklist_pop(board->worklist, &i, &j)) {
+		switch(board_solve_from_tile(board, i, j)) {
+		case BOARD_SOLVE_TILE_SUCCESS:
+			deduced_anything |= 1;
+			break;
+		case BOARD_SOLVE_TILE_NOTHING:
+			break;
+		case BOARD_SOLVE_TILE_ERROR:
+			fprintf(stderr, "Buggered %i,%i\n", i, j);
+			BOARD_AT(board, i, j) |= TILE_BUGGERED;
+			board_print(board, stderr);
+
+			return BOARD_SOLVE_BUG;
 		}
 	}
 
+	board_count_stage(board, BOARD_STAGE_SIMPLE, deduced, start);
+
 	if (board_is_solved(board)) return BOARD_SOLVE_SUCCESS;
 	if (deduced_anything) return BOARD_SOLVE_PARTIAL;
 
+	deduced = board->worklist->n_revealed;
+	start = board->stats ? board_stats_now_ns() : 0;
+	ret = board_deduce_frontier_cases(board, 1);
+	board_count_stage(board, BOARD_STAGE_FRONTIER, deduced, start);
+
+	switch (ret) {
+	case BOARD_SOLVE_SUCCESS:
+		return BOARD_SOLVE_PARTIAL;
+	case BOARD_SOLVE_BUG:
+		return BOARD_SOLVE_BUG;
+	}
+
 	return BOARD_SOLVE_MUST_GUESS;
 }
 
@@ -432,16 +1144,17 @@ static int board_solve_from_tile(struct minesweeper_board *board, int row, int c
 
 	tile = &BOARD_AT(board, row, col);
 
-	if (*tile > 8) return 0;
+	if (*tile > 8) return BOARD_SOLVE_TILE_NOTHING;
 
 	surrounding_mines = *tile;
+	BOARD_COUNT(board, neighborhoods, 1);
 
 	BOARD_FOREACH_NEIGHBOR(board, row, col, i, j, tile) {
-		if (*tile == TILE_MINE) known_mines++;
+		if (TILE_IS_KNOWN_MINE(*tile)) known_mines++;
 		if (*tile & TILE_UNKNOWN) unknown_neighbors++;
 	}
 
-	if (!unknown_neighbors) return 0;
+	if (!unknown_neighbors) return BOARD_SOLVE_TILE_NOTHING;
 
 	if (surrounding_mines == 0) {
 		board_fill_empty_tiles(board, row, col);
@@ -491,6 +1204,7 @@ static void board_fill_empty_tiles(struct minesweeper_board *board, int row, int
 	struct tile_coordinate_s *tiles_to_fill;
 	struct tile_coordinate_s *current;
 	struct tile_coordinate_s *write_head;
+	struct arena_mark mark;
 	int ro;
 	int co;
 	unsigned char *tile;
@@ -498,7 +1212,11 @@ static void board_fill_empty_tiles(struct minesweeper_board *board, int row, int
 	if (BOARD_AT(board, row, col) != TILE_CLEAR)
 		return;
 
-	tiles_to_fill = malloc(sizeof(tiles_to_fill[0]) * board->rows * board->cols);
+	tiles_to_fill = board_scratch_alloc(board,
+			sizeof(tiles_to_fill[0]) * board->rows * board->cols, &mark);
+
+	if (!tiles_to_fill)
+		return;
 
 	current = tiles_to_fill;
 	current->row = row;
@@ -513,71 +1231,155 @@ static void board_fill_empty_tiles(struct minesweeper_board *board, int row, int
 				write_head++;
 			}
 
-			tile_reveal_clear(board, current->row + ro, current->col + co);
+			if (*tile & TILE_UNKNOWN)
+				tile_reveal_clear(board, current->row + ro, current->col + co);
 		}
 
-		current++;
+		current++;
+	}
+
+	board_scratch_free(board, tiles_to_fill, &mark);
+}
+
+const char *const board_stage_names[BOARD_N_STAGES] = {
+	"simple",
+	"pairs",
+	"windows",
+	"frontier",
+};
+
+/* Every stage, cheapest first */
+void board_pipeline_init(struct board_pipeline *pipeline)
+{
+	int i;
+
+	memset(pipeline, 0, sizeof(*pipeline));
+
+	for (i = 0; i < BOARD_N_STAGES; i++)
+		pipeline->stages[pipeline->n_stages++] = i;
+}
+
+/* Takes the stages to run from a comma separated list of their names, in
+ * the order given. Returns non-zero if the list is empty, names a stage
+ * that does not exist or names one twice.
+ * */
+int board_pipeline_parse(struct board_pipeline *pipeline, const char *list)
+{
+	const char *end;
+	size_t length;
+	int stage;
+	int i;
+
+	memset(pipeline, 0, sizeof(*pipeline));
+
+	for (;;) {
+		end = strchr(list, ',');
+		length = end ? (size_t)(end - list) : strlen(list);
+
+		for (stage = 0; stage < BOARD_N_STAGES; stage++)
+			if (strlen(board_stage_names[stage]) == length
+					&& !strncmp(board_stage_names[stage], list, length))
+				break;
+
+		if (stage == BOARD_N_STAGES)
+			return 1;
+
+		for (i = 0; i < pipeline->n_stages; i++)
+			if (pipeline->stages[i] == (enum board_stage)stage)
+				return 1;
+
+		pipeline->stages[pipeline->n_stages++] = stage;
+
+		if (!end)
+			return 0;
+
+		list = end + 1;
 	}
-
-	free(tiles_to_fill);
 }
 
-#define BUF_APPEND_STR(__buf, __str) do { gr_buf_append(__buf, __str, sizeof(__str) - 1); } while (0)
-
-void board_deduce_partial(struct minesweeper_board *board)
+int board_deduce_partial(struct minesweeper_board *board, struct gr_buffer *out)
 {
-	long max_attempts;
-	int attempts = 0;
 	int ret = BOARD_SOLVE_MUST_GUESS;
-	struct gr_buffer strbuf;
+	int i = 0;
+	int deduced;
+	uint64_t start;
+	enum board_stage stage;
+	struct board_worklist worklist;
+	struct deduce_cache cache;
+	struct board_arena arena;
+	struct board_pipeline own_pipeline;
+	const struct board_pipeline *pipeline = board->pipeline;
+	int own_cache = 0;
+	int own_arena = 0;
+
+	if (worklist_init(&worklist, board->rows, board->cols)) {
+		fputs("BUG!", stderr);
+		return BOARD_SOLVE_BUG;
+	}
+
+	if (!board->cache && !deduce_cache_init(&cache, DEDUCE_CACHE_DEFAULT_SIZE)) {
+		board->cache = &cache;
+		own_cache = 1;
+	}
 
-	gr_buf_init(&strbuf, 64);
-	max_attempts = board->rows * board->cols;
+	if (!board->arena) {
+		arena_init(&arena);
+		board->arena = &arena;
+		own_arena = 1;
+	}
+
+	if (!pipeline) {
+		board_pipeline_init(&own_pipeline);
+		pipeline = &own_pipeline;
+	}
+
+	board->worklist = &worklist;
+	board_queue_simple_cases(board);
+	BOARD_COUNT(board, boards, 1);
 
-	while (attempts < max_attempts) {
-		switch (board_deduce_guaranteed_cases(board)) {
+	/* Every stage that succeeds deduces at least one more tile, so this
+	 * ends once the board runs out of unknown tiles at the latest
+	 * */
+	while (i < pipeline->n_stages) {
+		stage = pipeline->stages[i];
+		deduced = worklist.n_revealed;
+		start = board->stats ? board_stats_now_ns() : 0;
+		arena_reset(board->arena);
+
+		switch (board_deduce_stage(board, stage)) {
 		case BOARD_SOLVE_SUCCESS:
 		case BOARD_SOLVE_PARTIAL:
-			attempts++;
 			ret = BOARD_SOLVE_SUCCESS;
+			i = 0;
 			break;
 		case BOARD_SOLVE_MUST_GUESS:
-			switch (board_deduce_partial_cases(board)) {
-			case BOARD_SOLVE_SUCCESS:
-				attempts++;
-				ret = BOARD_SOLVE_SUCCESS;
-				goto again;
-			case BOARD_SOLVE_MUST_GUESS:
-				goto end;
-			case BOARD_SOLVE_BUG:
-				goto bug;
-			}
-
-			if (ret != BOARD_SOLVE_SUCCESS)
-				puts("Nothing can be deduced.");
-
-			goto end;
+			i++;
+			break;
 		default:
 			goto bug;
 		}
 
-again:
-		continue;
+		board_count_stage(board, stage, deduced, start);
 	}
 
 end:
-	if (attempts < max_attempts) {
-		BUF_APPEND_STR(&strbuf, "Deduced:\n");
-	} else {
-		BUF_APPEND_STR(&strbuf, "It's taking too long. Clearly, we fucked something up...\n");
-	}
+	BUF_APPEND_STR(out, "Deduced:\n");
+	board_to_string_buf(board, out);
 
-	board_to_string_buf(board, &strbuf);
-	buf_write(&strbuf, stdout);
+	board->worklist = NULL;
+	worklist_destroy(&worklist);
 
-	gr_buf_delete(&strbuf);
+	if (own_cache) {
+		board->cache = NULL;
+		deduce_cache_destroy(&cache);
+	}
+
+	if (own_arena) {
+		board->arena = NULL;
+		arena_destroy(&arena);
+	}
 
-	return;
+	return ret;
 
 bug:
 	fputs("BUG!", stderr);
@@ -585,27 +1387,187 @@ bug:
 	goto end;
 }
 
-static int board_deduce_guaranteed_cases(struct minesweeper_board *board)
+static int board_deduce_stage(struct minesweeper_board *board, enum board_stage stage)
+{
+	switch (stage) {
+	case BOARD_STAGE_SIMPLE:
+		return board_deduce_guaranteed_cases(board);
+	case BOARD_STAGE_PAIRS:
+		return board_deduce_pair_cases(board);
+	case BOARD_STAGE_WINDOWS:
+		return board_deduce_partial_cases(board);
+	case BOARD_STAGE_FRONTIER:
+		return board_deduce_frontier_cases(board, 0);
+	default:
+		return BOARD_SOLVE_BUG;
+	}
+}
+
+/* Deduced is how many tiles had been deduced before the stage started */
+static void board_count_stage(struct minesweeper_board *board, enum board_stage stage,
+		int deduced, uint64_t start)
+{
+	struct board_stage_stats *stats;
+
+	if (!board->stats)
+		return;
+
+	stats = &board->stats->stages[stage];
+	stats->invocations++;
+	stats->deductions += board->worklist->n_revealed - deduced;
+	stats->ns += board_stats_now_ns() - start;
+}
+
+/* Temporaries come out of board->arena if there is one and the heap if not.
+ * Either way they are freed in the reverse order of allocation, which hands
+ * the arena back everything up to the mark.
+ * */
+static void *board_scratch_alloc(struct minesweeper_board *board, size_t size,
+		struct arena_mark *mark)
+{
+	if (!board->arena)
+		return malloc(size);
+
+	*mark = arena_save(board->arena);
+	return arena_alloc(board->arena, size);
+}
+
+static void board_scratch_free(struct minesweeper_board *board, void *ptr,
+		const struct arena_mark *mark)
+{
+	if (!board->arena)
+		free(ptr);
+	else
+		arena_restore(board->arena, *mark);
+}
+
+/* The individual rules board_deduce_partial() is made of, so they can be run
+ * (and timed) on their own. Each returns BOARD_SOLVE_SUCCESS if it deduced
+ * anything and BOARD_SOLVE_MUST_GUESS if not.
+ * */
+int board_deduce_simple(struct minesweeper_board *board)
+{
+	struct board_worklist worklist;
+	int ret;
+
+	if (board->worklist)
+		return board_deduce_guaranteed_cases(board);
+
+	if (worklist_init(&worklist, board->rows, board->cols))
+		return BOARD_SOLVE_BUG;
+
+	board->worklist = &worklist;
+	board_queue_simple_cases(board);
+
+	ret = board_deduce_guaranteed_cases(board);
+
+	board->worklist = NULL;
+	worklist_destroy(&worklist);
+
+	return ret;
+}
+
+int board_deduce_pairs(struct minesweeper_board *board)
+{
+	return board_deduce_pair_cases(board);
+}
+
+/* Windows are only enumerated if no pair of numbers settles anything */
+int board_deduce_windows(struct minesweeper_board *board)
+{
+	int ret;
+
+	ret = board_deduce_pair_cases(board);
+
+	if (ret != BOARD_SOLVE_MUST_GUESS)
+		return ret;
+
+	return board_deduce_partial_cases(board);
+}
+
+int board_deduce_frontier(struct minesweeper_board *board)
+{
+	return board_deduce_frontier_cases(board, 0);
+}
+
+/* Runs the 3x3 window rule on the numbered tiles whose outcome can depend on
+ * row, col. A window looks at the numbers around it too, so that is every
+ * tile up to two steps away. The pair rule gets the first go at each tile.
+ * */
+int board_deduce_windows_around(struct minesweeper_board *board, int row, int col)
 {
+	int ret = BOARD_SOLVE_MUST_GUESS;
+	unsigned char tile;
 	int i;
 	int j;
-	int ret = BOARD_SOLVE_MUST_GUESS;
 
-	for (i = 0; i < board->rows; i++) {
-		for (j = 0; j < board->cols; j++) {
-			switch (board_deduce_from_tile(board, i, j)) {
+	for (i = row - 2; i <= row + 2; i++) {
+		if (i < 0 || i >= board->rows)
+			continue;
+
+		for (j = col - 2; j <= col + 2; j++) {
+			if (j < 0 || j >= board->cols)
+				continue;
+
+			tile = BOARD_AT(board, i, j);
+
+			if (tile > 8 || tile == 0)
+				continue;
+
+			switch (board_deduce_window_from_tile(board, i, j)) {
 			case BOARD_SOLVE_TILE_SUCCESS:
 				ret = BOARD_SOLVE_SUCCESS;
 				break;
 			case BOARD_SOLVE_TILE_NOTHING:
 				break;
 			default:
-				ret = BOARD_SOLVE_BUG;
-				goto end;
+				return BOARD_SOLVE_BUG;
 			}
 		}
 	}
 
+	return ret;
+}
+
+/* The window rule on the numbered tile at row, col alone, for callers that
+ * keep track of which windows changed themselves
+ * */
+int board_deduce_window(struct minesweeper_board *board, int row, int col)
+{
+	unsigned char tile = BOARD_AT(board, row, col);
+
+	if (tile > 8 || tile == 0)
+		return BOARD_SOLVE_MUST_GUESS;
+
+	switch (board_deduce_window_from_tile(board, row, col)) {
+	case BOARD_SOLVE_TILE_SUCCESS:
+		return BOARD_SOLVE_SUCCESS;
+	case BOARD_SOLVE_TILE_NOTHING:
+		return BOARD_SOLVE_MUST_GUESS;
+	default:
+		return BOARD_SOLVE_BUG;
+	}
+}
+
+static int board_deduce_guaranteed_cases(struct minesweeper_board *board)
+{
+	int i;
+	int j;
+	int ret = BOARD_SOLVE_MUST_GUESS;
+
+	while (worklist_pop(board->worklist, &i, &j)) {
+		switch (board_deduce_from_tile(board, i, j)) {
+		case BOARD_SOLVE_TILE_SUCCESS:
+			ret = BOARD_SOLVE_SUCCESS;
+			break;
+		case BOARD_SOLVE_TILE_NOTHING:
+			break;
+		default:
+			ret = BOARD_SOLVE_BUG;
+			goto end;
+		}
+	}
+
 end:
 	return ret;
 }
@@ -656,13 +1618,13 @@ static int board_deduce_from_tile(struct minesweeper_board *board, int row, int
 
 	if (surrounding_mines == 0 || surrounding_mines == hood.n_mines) {
 		BOARD_FOREACH_NEIGHBOR(board, row, col, i, j, tile)
-			if ((*tile & (TILE_UNKNOWN | TILE_DEDUCED)) == TILE_UNKNOWN)
+			if (TILE_IS_OPEN(*tile))
 				tile_deduce_clear(board, row, col, i, j);
 
 		return BOARD_SOLVE_TILE_SUCCESS;
 	} else if (hood.n_unknown + hood.n_mines == surrounding_mines) {
 		BOARD_FOREACH_NEIGHBOR(board, row, col, i, j, tile)
-			if ((*tile & (TILE_UNKNOWN | TILE_DEDUCED)) == TILE_UNKNOWN)
+			if (TILE_IS_OPEN(*tile))
 				tile_deduce_mine(board, row, col, i, j);
 
 		return BOARD_SOLVE_TILE_SUCCESS;
@@ -680,11 +1642,10 @@ static int board_deduce_partial_cases(struct minesweeper_board *board)
 	int ret = BOARD_SOLVE_MUST_GUESS;
 	unsigned char tile;
 
-	if (board->rows < 3 || board->cols < 3)
-		goto end;
+	BOARD_COUNT(board, tiles_scanned, (unsigned long)board->rows * board->cols);
 
-	for (i = 1; i < board->rows - 1; i++) {
-		for (j = 1; j < board->cols - 1; j++) {
+	for (i = 0; i < board->rows; i++) {
+		for (j = 0; j < board->cols; j++) {
 			tile = BOARD_AT(board, i, j);
 
 			if (tile > 8 || tile == 0)
@@ -707,6 +1668,173 @@ end:
 	return ret;
 }
 
+static int board_deduce_pair_cases(struct minesweeper_board *board)
+{
+	int i;
+	int j;
+	int ret = BOARD_SOLVE_MUST_GUESS;
+	unsigned char tile;
+
+	BOARD_COUNT(board, tiles_scanned, (unsigned long)board->rows * board->cols);
+
+	for (i = 0; i < board->rows; i++) {
+		for (j = 0; j < board->cols; j++) {
+			tile = BOARD_AT(board, i, j);
+
+			if (tile > 8 || tile == 0)
+				continue;
+
+			if (board_deduce_pairs_from_tile(board, i, j) == BOARD_SOLVE_TILE_SUCCESS)
+				ret = BOARD_SOLVE_SUCCESS;
+		}
+	}
+
+	return ret;
+}
+
+/* The window rule, enumerating only if the pair rule does nothing */
+static int board_deduce_window_from_tile(struct minesweeper_board *board, int row, int col)
+{
+	if (board_deduce_pairs_from_tile(board, row, col) == BOARD_SOLVE_TILE_SUCCESS)
+		return BOARD_SOLVE_TILE_SUCCESS;
+
+	return board_deduce_partial_from_tile(board, row, col);
+}
+
+/* The tiles up to three away from a tile, as bits of a 7x7 frame. The
+ * neighborhood of a tile at ro, co from the middle is HOOD_FRAME_AT(ro, co).
+ * */
+#define HOOD_FRAME_COLS		7
+#define HOOD_FRAME_BIT(__ro, __co)	\
+	((uint64_t)1 << (((__ro) + 3) * HOOD_FRAME_COLS + (__co) + 3))
+#define HOOD_FRAME_AT(__ro, __co)	\
+	((uint64_t)0x1c387 << (((__ro) + 2) * HOOD_FRAME_COLS + (__co) + 2))
+
+/* This solves cases that take two numbers, like the following:
+ *
+ *	? ? ? ?		? ? ? ?
+ *	1 1 . .		1 2 . .
+ *
+ * Whatever the unknown tiles two numbers share hold, each number has to get
+ * the rest of its mines from the tiles only it sees. When the counts leave
+ * no room, that settles them. Only tiles around row, col are deduced, the
+ * other number gets its turn as row, col too.
+ * */
+static int board_deduce_pairs_from_tile(struct minesweeper_board *board, int row, int col)
+{
+	int i;
+	int j;
+	int ret = BOARD_SOLVE_TILE_NOTHING;
+	int missing;		/* Mines around row, col not known yet */
+	int other_missing;	/* Same for the other number */
+	int least;		/* Mines the shared tiles hold at least */
+	int most;		/* and at most */
+	int n_only;
+	int bit;
+	uint64_t unknown = 0;
+	uint64_t mines = 0;
+	uint64_t hood;
+	uint64_t other;
+	uint64_t only;
+	unsigned char number;
+	unsigned char tile;
+	unsigned char *around;
+
+	number = BOARD_AT(board, row, col);
+
+	if (number > 8)
+		return BOARD_SOLVE_TILE_NOTHING;
+
+	/* Most numbers are done with */
+	BOARD_FOREACH_NEIGHBOR(board, row, col, i, j, around)
+		if (TILE_IS_OPEN(*around))
+			goto frame;
+
+	return BOARD_SOLVE_TILE_NOTHING;
+
+frame:
+	for (i = -3; i <= 3; i++) {
+		if (row + i < 0 || row + i >= board->rows)
+			continue;
+
+		for (j = -3; j <= 3; j++) {
+			if (col + j < 0 || col + j >= board->cols)
+				continue;
+
+			tile = BOARD_AT(board, row + i, col + j);
+
+			if (TILE_IS_OPEN(tile))
+				unknown |= HOOD_FRAME_BIT(i, j);
+			else if (tile & TILE_MINE)
+				mines |= HOOD_FRAME_BIT(i, j);
+		}
+	}
+
+	hood = HOOD_FRAME_AT(0, 0);
+
+	for (i = -2; i <= 2; i++) {
+		for (j = -2; j <= 2 && (unknown & hood); j++) {
+			other = HOOD_FRAME_AT(i, j);
+
+			if ((!i && !j) || !(unknown & hood & other)
+					|| row + i < 0 || row + i >= board->rows
+					|| col + j < 0 || col + j >= board->cols)
+				continue;
+
+			tile = BOARD_AT(board, row + i, col + j);
+
+			if (tile > 8)
+				continue;
+
+			BOARD_COUNT(board, pairs, 1);
+			missing = number - popcount(mines & hood);
+			other_missing = tile - popcount(mines & other);
+			only = unknown & hood & ~other;
+			n_only = popcount(only);
+
+			least = missing - n_only;
+			most = popcount(unknown & hood & other);
+
+			if (least < other_missing - popcount(unknown & other & ~hood))
+				least = other_missing - popcount(unknown & other & ~hood);
+
+			if (least < 0) least = 0;
+			if (most > missing) most = missing;
+			if (most > other_missing) most = other_missing;
+
+			/* The tiles only row, col sees hold missing - most to
+			 * missing - least mines. Anything else is a broken
+			 * board, left for enumeration to not make sense of.
+			 * */
+			if (!only || least > most)
+				continue;
+
+			if (least != missing && most != missing - n_only)
+				continue;
+
+			unknown &= ~only;
+
+			if (least != missing)
+				mines |= only;
+
+			for (; only; only &= only - 1) {
+				bit = lowest_bit(only);
+
+				if (least == missing)
+					tile_deduce_clear(board, row, col,
+							bit / HOOD_FRAME_COLS - 3, bit % HOOD_FRAME_COLS - 3);
+				else
+					tile_deduce_mine(board, row, col,
+							bit / HOOD_FRAME_COLS - 3, bit % HOOD_FRAME_COLS - 3);
+			}
+
+			ret = BOARD_SOLVE_TILE_SUCCESS;
+		}
+	}
+
+	return ret;
+}
+
 static int board_count_unknown_outside_neighbors(
 		const struct minesweeper_board *board,
 		int from_row, int from_col,
@@ -730,23 +1858,6 @@ static int board_count_known_outside_mines(
  * */
 static int board_deduce_partial_from_tile(struct minesweeper_board *board, int row, int col)
 {
-	/* Patterns that mask out mine bits irrelevant to calculating the
-	 * neighbor mine count of a particular tile
-	 * */
-	static const uint16_t mine_count_masks[] = {
-		3 | (3 << 3),
-		7 | (7 << 3),
-		6 | (6 << 3),
-
-		3 | 3 << 3 | 3 << 6,
-		~(~0U << 9),
-		6 | 6 << 3 | 6 << 6,
-
-		3 << 3 | 3 << 6,
-		7 << 3 | 7 << 6,
-		6 << 3 | 6 << 6
-	};
-
 	int i;
 	int j;
 	int ret = BOARD_SOLVE_TILE_NOTHING;
@@ -754,25 +1865,33 @@ static int board_deduce_partial_from_tile(struct minesweeper_board *board, int r
 	int co;	/* Neighbor column offset*/
 	int viable_solutions_exist;
 	int tile_idx;
-	int deficit;
-	int cannot_satisfy_neighbor;
-	int too_many_mines;
+	int least;
+	int most;
 	unsigned short always_mine;
 	unsigned short always_clear;
 	unsigned short mines;
 	unsigned char *tile;
 	unsigned char total_mines;
+	unsigned long layouts = 0;	/* Tried, for board->stats */
+	unsigned long too_few = 0;
+	unsigned long too_many = 0;
 
 	/* How many mines expected to come from the neighborhood of this tile */
 	unsigned char expected_mine_counts[9];
 
 	unsigned char unknown_outside_neighbors[9] = { 0 };
 
-	unsigned char mine_locations = 0;		/* How many tiles can host a mine */
+	/* Per tile range of mines it may see inside this window, packed like
+	 * layout_counts
+	 * */
+	uint64_t lower_bounds = 0;
+	uint64_t upper_bounds = 0;
+
 	unsigned char missing_mines = 0;		/* Mines we must place */
-	unsigned char possible_mine_locations[9];	/* Indices of possible mine locations */
-	struct n_choose_k_uc_itr nck_itr;		/* Generator of unique choices */
+	struct mask_choose_itr choice_itr;		/* Generator of unique choices */
 	struct tile_neighborhood_s neighborhood;
+	struct deduce_cache_key cache_key;
+	struct deduce_cache_result cached;
 
 	total_mines = BOARD_AT(board, row, col);
 	expected_mine_counts[4] = total_mines;
@@ -782,14 +1901,17 @@ static int board_deduce_partial_from_tile(struct minesweeper_board *board, int r
 	BOARD_FOREACH_NEIGHBOR(board, row, col, ro, co, tile) {
 		tile_idx = (ro + 1) * 3 + co + 1;
 
+		/* Nothing to expect from beyond the edge. tile_neighborhood()
+		 * marks these as deduced so they are never checked either.
+		 * */
+		if (*tile == TILE_OUTSIDE)
+			continue;
+
 		if (*tile <= 8) {
 			expected_mine_counts[tile_idx] = *tile - board_count_known_outside_mines(
 				board, row, col, row + ro, col + co);
 		}
 
-		if ((*tile & (TILE_UNKNOWN | TILE_DEDUCED)) == TILE_UNKNOWN)
-			possible_mine_locations[mine_locations++] = tile_idx;
-
 		unknown_outside_neighbors[tile_idx] = board_count_unknown_outside_neighbors(
 				board, row, col, row + ro, col + co);
 	}
@@ -804,34 +1926,76 @@ static int board_deduce_partial_from_tile(struct minesweeper_board *board, int r
 
 	viable_solutions_exist = 0;
 
+	/* A layout is acceptable if every number in the window sees no more
+	 * mines than it expects and no fewer than it could still get from
+	 * outside of the window.
+	 * */
+	for (i = 0; (size_t)i < sizeof(expected_mine_counts); i++) {
+		/* Not a clear tile or deduced this iteration. In either case
+		 * how many mines are supposed to be around this tile cannot be
+		 * known. Anything goes.
+		 * */
+		if ((1 << i) & (neighborhood.mines | neighborhood.unknown | neighborhood.deduced)) {
+			least = 0;
+			most = LAYOUT_FIELD_MAX;
+		} else {
+			most = expected_mine_counts[i];
+			least = most - unknown_outside_neighbors[i];
+
+			if (least < 0) least = 0;
+			if (least > LAYOUT_FIELD_MAX) least = LAYOUT_FIELD_MAX;
+			if (most > LAYOUT_FIELD_MAX) most = LAYOUT_FIELD_MAX;
+		}
+
+		lower_bounds |= (uint64_t)least << (i * LAYOUT_FIELD_BITS);
+		upper_bounds |= (uint64_t)most << (i * LAYOUT_FIELD_BITS);
+	}
+
+	/* The outcome depends on nothing but the bounds, which tiles are
+	 * unknown or mines and how many mines are missing. Those patterns
+	 * repeat a lot.
+	 * */
+	cache_key.lower_bounds = lower_bounds;
+	cache_key.upper_bounds = upper_bounds;
+	cache_key.window = neighborhood.unknown
+		| (uint32_t)neighborhood.mines << 9
+		| (uint32_t)missing_mines << 18;
+
+	BOARD_COUNT(board, windows, 1);
+
+	if (board->cache && deduce_cache_lookup(board->cache, &cache_key, &cached)) {
+		BOARD_COUNT(board, window_cache_hits, 1);
+		always_mine = cached.always_mine;
+		always_clear = cached.always_clear;
+		viable_solutions_exist = cached.viable;
+		goto deduce;
+	}
+
+	if (board->cache)
+		BOARD_COUNT(board, window_cache_misses, 1);
+
 	/* Enumarate all mine placements */
-	FOREACH_N_CHOOSE_K(&nck_itr, mine_locations, missing_mines) {
+	FOREACH_MASK_CHOOSE_K(&choice_itr, neighborhood.unknown, missing_mines) {
 		if (!always_mine && !always_clear)
 			break;
 
-		mines = neighborhood.mines;
-
-		for (i = 0; i < nck_itr.nchoices; i++)
-			mines |= 1 << (possible_mine_locations[nck_itr.choices[i]]);
+		mines = neighborhood.mines | choice_itr.mask;
+		layouts++;
 
 		/* Check if current layout produces the expected mine neighbor
-		 * counts.
+		 * counts. A field's guard bit survives the subtraction only if
+		 * it did not need to borrow.
 		 * */
-		for (i = 0; (size_t)i < sizeof(expected_mine_counts); i++) {
-			/* Not a clear tile or deduced this iteration. In
-			 * either case how many mines are supposed to be
-			 * around this tile cannot be known. Skip.
-			 * */
-			if ((1 << i) & (neighborhood.mines | neighborhood.unknown | neighborhood.deduced))
-				continue;
-
-			deficit = expected_mine_counts[i] - popcount(mines & mine_count_masks[i]);
-			cannot_satisfy_neighbor = deficit > unknown_outside_neighbors[i];
-
-			too_many_mines = popcount(mines & mine_count_masks[i]) > expected_mine_counts[i];
+		if (((((layout_counts[mines] | LAYOUT_GUARDS) - lower_bounds)
+				& (((upper_bounds | LAYOUT_GUARDS) - layout_counts[mines])))
+				& LAYOUT_GUARDS) != LAYOUT_GUARDS) {
+			if ((((layout_counts[mines] | LAYOUT_GUARDS) - lower_bounds)
+					& LAYOUT_GUARDS) != LAYOUT_GUARDS)
+				too_few++;
+			else
+				too_many++;
 
-			if (cannot_satisfy_neighbor || too_many_mines)
-				goto enumerate_next;
+			continue;
 		}
 
 		viable_solutions_exist = 1;
@@ -841,11 +2005,20 @@ static int board_deduce_partial_from_tile(struct minesweeper_board *board, int r
 		 * */
 		always_mine &= mines;
 		always_clear &= ~mines;
+	}
 
-enumerate_next:
-		continue;
+	BOARD_COUNT(board, layouts, layouts);
+	BOARD_COUNT(board, layouts_too_few, too_few);
+	BOARD_COUNT(board, layouts_too_many, too_many);
+
+	if (board->cache) {
+		cached.always_mine = always_mine;
+		cached.always_clear = always_clear;
+		cached.viable = viable_solutions_exist;
+		deduce_cache_store(board->cache, &cache_key, &cached);
 	}
 
+deduce:
 	if (!viable_solutions_exist)
 		goto end;
 
@@ -873,6 +2046,88 @@ end:
 	return ret;
 }
 
+/* Unlike board_deduce_partial_from_tile(), which only ever sees one 3x3
+ * window, this looks at every unknown tile bordering a number at once. The
+ * frontier is split into independent components and each component is
+ * enumerated exactly once (see frontier.c), so deductions that need several
+ * overlapping numbers are found too.
+ *
+ * Enumeration works within a budget of search nodes and leaves whatever it
+ * does not get to undecided rather than taking arbitrarily long, so the stage
+ * is safe to run by default.
+ *
+ * When reveal is set, deduced tiles are revealed as if clicked, which is what
+ * board_solve_iteration() wants. Otherwise they are marked as deduced.
+ * */
+static int board_deduce_frontier_cases(struct minesweeper_board *board, int reveal)
+{
+	int i;
+	int ret = BOARD_SOLVE_MUST_GUESS;
+	unsigned char *verdicts = NULL;
+	struct arena_mark mark;
+	struct frontier frontier;
+	struct frontier_cell *cell;
+	struct frontier_constraint *constraint;
+
+	if (frontier_build(&frontier, board))
+		return BOARD_SOLVE_BUG;
+
+	BOARD_COUNT(board, frontiers, 1);
+	BOARD_COUNT(board, frontier_components, frontier.n_components);
+	BOARD_COUNT(board, frontier_cells, frontier.n_cells);
+
+	if (!frontier.n_cells)
+		goto end;
+
+	verdicts = board_scratch_alloc(board, frontier.n_cells * sizeof(verdicts[0]), &mark);
+
+	if (!verdicts) {
+		ret = BOARD_SOLVE_BUG;
+		goto end;
+	}
+
+	/* Enumeration only gets a go if row reduction finds nothing */
+	if (!frontier_reduce(&frontier, verdicts)
+			&& !frontier_decide_jobs(&frontier, verdicts, board->jobs))
+		goto end;
+
+	for (i = 0; i < frontier.n_cells; i++) {
+		cell = &frontier.cells[i];
+		constraint = &frontier.constraints[cell->constraints[0]];
+
+		switch (verdicts[i]) {
+		case FRONTIER_MINE:
+			if (reveal)
+				tile_reveal_mine(board, cell->row, cell->col);
+			else
+				tile_deduce_mine(board, constraint->row, constraint->col,
+						cell->row - constraint->row,
+						cell->col - constraint->col);
+
+			ret = BOARD_SOLVE_SUCCESS;
+			break;
+		case FRONTIER_CLEAR:
+			if (reveal)
+				tile_reveal_clear(board, cell->row, cell->col);
+			else
+				tile_deduce_clear(board, constraint->row, constraint->col,
+						cell->row - constraint->row,
+						cell->col - constraint->col);
+
+			ret = BOARD_SOLVE_SUCCESS;
+			break;
+		}
+	}
+
+end:
+	if (verdicts)
+		board_scratch_free(board, verdicts, &mark);
+
+	frontier_destroy(&frontier);
+
+	return ret;
+}
+
 #ifndef ABS
 #	define ABS(__a) (((__a) < 0) ? -(__a) : (__a))
 #endif
@@ -891,7 +2146,7 @@ static int board_count_unknown_outside_neighbors(
 		if (ABS(for_row + ro - from_row) < 2 && ABS(for_col + co - from_col) < 2)
 			continue;
 
-		if ((*tile & (TILE_UNKNOWN | TILE_DEDUCED)) == TILE_UNKNOWN)
+		if (TILE_IS_OPEN(*tile))
 			ret++;
 	}
 
@@ -931,6 +2186,10 @@ static void tile_deduce_clear(const struct minesweeper_board *board,
 	}
 
 	BOARD_AT(board, row + ro, col + co) = TILE_DEDUCED | TILE_CLEAR;
+	board_queue_neighbors(board, row + ro, col + co);
+
+	if (board->worklist)
+		worklist_log_reveal(board->worklist, row + ro, col + co);
 
 	if (BOARD_DEBUG) {
 		tile_neighborhood(board, row, col, &hood);
@@ -955,6 +2214,10 @@ static void tile_deduce_mine(const struct minesweeper_board *board,
 	}
 
 	BOARD_AT(board, row + ro, col + co) = TILE_DEDUCED | TILE_MINE;
+	board_queue_neighbors(board, row + ro, col + co);
+
+	if (board->worklist)
+		worklist_log_reveal(board->worklist, row + ro, col + co);
 
 	if (BOARD_DEBUG) {
 		tile_neighborhood(board, row, col, &hood);
@@ -986,8 +2249,12 @@ static void tile_reveal_mine(struct minesweeper_board *board, int row, int col)
 		}
 	}
 
+	if (board->worklist && (BOARD_AT(board, row, col) & TILE_UNKNOWN))
+		worklist_log_reveal(board->worklist, row, col);
+
 	BOARD_AT(board, row, col) &= ~TILE_UNKNOWN;
 	BOARD_AT(board, row, col) |= TILE_DEDUCED;
+	board_queue_neighbors(board, row, col);
 }
 
 static void tile_reveal_clear(struct minesweeper_board *board, int row, int col)
@@ -1000,8 +2267,12 @@ static void tile_reveal_clear(struct minesweeper_board *board, int row, int col)
 		}
 	}
 
+	if (board->worklist && (BOARD_AT(board, row, col) & TILE_UNKNOWN))
+		worklist_log_reveal(board->worklist, row, col);
+
 	BOARD_AT(board, row, col) &= ~TILE_UNKNOWN;
 	BOARD_AT(board, row, col) |= TILE_DEDUCED;
+	board_queue_neighbors(board, row, col);
 }
 
 static void tile_neighborhood(
@@ -1015,6 +2286,7 @@ static void tile_neighborhood(
 	unsigned char *tile;
 
 	memset(ret, 0, sizeof(*ret));
+	BOARD_COUNT(board, neighborhoods, 1);
 
 	BOARD_FOREACH_NEIGHBOR(board, row, col, ro, co, tile) {
 		tile_idx = (ro + 1) * 3 + co + 1;
@@ -1022,7 +2294,7 @@ static void tile_neighborhood(
 		if (*tile & TILE_DEDUCED)
 			ret->deduced |= 1 << tile_idx;
 
-		if ((*tile & (TILE_UNKNOWN | TILE_DEDUCED)) == TILE_UNKNOWN) {
+		if (TILE_IS_OPEN(*tile)) {
 			ret->n_unknown++;
 			ret->unknown |= 1 << tile_idx;
 		} else if (*tile & TILE_MINE) {
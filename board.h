@@ -1,6 +1,7 @@
 #ifndef MINESWEEPER_SOLVER_H
 #define MINESWEEPER_SOLVER_H
 
+#include <stdint.h>
 #include <stdio.h>
 
 #include <gramas/buf.h>
@@ -15,44 +16,88 @@
 #define TILE_DEDUCED_MINE	(TILE_MINE | TILE_DEDUCED)
 #define TILE_DEDUCED_CLEAR	(TILE_CLEAR | TILE_DEDUCED)
 
+/* Fills the border around a board. It is neither unknown, nor a mine, nor a
+ * number, so every rule simply ignores it.
+ * */
+#define TILE_OUTSIDE		(TILE_DEDUCED | TILE_BUGGERED)
+
 #define TILE_IS_CLEAR(__tile)		(((__tile) & ~(TILE_DEDUCED | TILE_UNKNOWN)) == TILE_CLEAR)
 #define TILE_IS_MINE(__tile)		(((__tile) & ~(TILE_DEDUCED | TILE_UNKNOWN)) == TILE_MINE)
 #define TILE_IS_KNOWN_MINE(__tile)	(((__tile) & ~TILE_DEDUCED) == TILE_MINE)
 #define TILE_IS_KNOWN_CLEAR(__tile)	(((__tile) & ~TILE_DEDUCED) == TILE_CLEAR)
+#define TILE_IS_OPEN(__tile)		(((__tile) & (TILE_UNKNOWN | TILE_DEDUCED)) == TILE_UNKNOWN)
 #define TILE_NEIGHBOR_MINES(__tile)	((__tile) & 0xF)
 
+struct board_worklist;
+struct deduce_cache;
+struct board_pipeline;
+struct board_stats;
+struct board_arena;
+
+/* Tiles are surrounded by a border of BOARD_PADDING TILE_OUTSIDE tiles on
+ * every side, so neighbors of any tile on the board can be looked at without
+ * checking bounds. tiles points at row 0, column 0 inside that border.
+ * */
+#define BOARD_PADDING	1
+
 struct minesweeper_board {
 	int rows;
 	int cols;
 	int row_capacity;
 	int col_capacity;
+	int stride;		/* Distance between vertically adjacent tiles */
 	unsigned char *tiles;
+	unsigned char *storage;
+
+	/* When set, every tile that gets revealed or deduced queues its
+	 * numbered neighbors here.
+	 * */
+	struct board_worklist *worklist;
+
+	/* Remembers what 3x3 windows deduced. If not set, board_deduce_partial()
+	 * uses a cache of its own for the duration of the call.
+	 * */
+	struct deduce_cache *cache;
+
+	/* Threads the frontier rule may spread independent parts of the
+	 * frontier over. 0 or 1 keeps it on the calling thread.
+	 * */
+	int jobs;
+
+	/* The rules board_deduce_partial() runs. If not set, every rule runs,
+	 * cheapest first.
+	 * */
+	const struct board_pipeline *pipeline;
+
+	/* Counts what the solver does if set, see stats.h */
+	struct board_stats *stats;
+
+	/* Scratch memory for temporaries of the rules, reset between steps and
+	 * stages. If not set, board_solve_full() and board_deduce_partial() use
+	 * an arena of their own for the duration of the call and anything else
+	 * uses malloc().
+	 * */
+	struct board_arena *arena;
 };
 
 void board_init(struct minesweeper_board *board, int rows, int cols);
 void board_destroy(struct minesweeper_board *board);
+void board_copy(struct minesweeper_board *dst, const struct minesweeper_board *src);
 
-static inline int __within_bounds(
-		const struct minesweeper_board *board,
-		int row, int col,
-		int row_ofst, int col_ofst)
-{
-	return row + row_ofst < board->rows && col + col_ofst < board->cols
-		&& row + row_ofst >= 0 && col + col_ofst >= 0;
-}
-
+/* __distance must not exceed BOARD_PADDING. Tiles past the edge of the board
+ * are visited too and read as TILE_OUTSIDE.
+ * */
 #define BOARD_FOREACH_IN_NEIGHBORHOOD(__board, __row, __col, __distance, __i, __j, __tile)	\
 	for ((__i) = -(__distance); (__i) <= (__distance); (__i)++)	\
 		for ((__j) = -(__distance); (__j) <= (__distance); (__j)++)	\
-			if (__within_bounds((__board), (__row), (__col), (__i), (__j)))	\
-				if ((__tile) = &BOARD_AT((__board), (__row) + (__i), (__col) + (__j)),	\
-						!((__i) == 0 && (__j) == 0))
+			if ((__tile) = &BOARD_AT((__board), (__row) + (__i), (__col) + (__j)),	\
+					!((__i) == 0 && (__j) == 0))
 
 #define BOARD_FOREACH_NEIGHBOR(__board, __row, __col, __i, __j, __tile)	\
 	BOARD_FOREACH_IN_NEIGHBORHOOD(__board, __row, __col, 1, __i, __j, __tile)
 
 #define BOARD_AT(__board, __row, __col)	\
-	((__board)->tiles[(__row) * (__board)->col_capacity + (__col)])
+	((__board)->tiles[(__row) * (__board)->stride + (__col)])
 
 void board_set_r(struct minesweeper_board *board,
 		int row, int col, unsigned char state);
@@ -60,11 +105,45 @@ void board_set_r(struct minesweeper_board *board,
 int board_is_full(const struct minesweeper_board *board);
 int board_is_partial(const struct minesweeper_board *board);
 int board_mine_numbers_consistent(const struct minesweeper_board *board);
+int board_count_neighbor_mines(const struct minesweeper_board *board, int row, int col);
 
 void board_read(struct minesweeper_board *board, FILE *file);
+void board_read_buf(struct minesweeper_board *board, const char *text, size_t length);
+void board_set_color(int color);
 int board_to_string_buf(const struct minesweeper_board *board, struct gr_buffer *buf);
 int board_print(const struct minesweeper_board *board, FILE *out);
 
+/* Binary corpora of boards, 4 bits per tile, with an index so that any board
+ * can be read straight out of a mapped file. Layout is in board.c.
+ * */
+#define BOARD_BIN_VERSION	1
+
+struct board_bin_writer {
+	FILE *out;
+	uint64_t offset;	/* Bytes written so far */
+	uint64_t *offsets;	/* Where every board written starts */
+	size_t n_boards;
+	size_t capacity;
+};
+
+struct board_bin {
+	const unsigned char *data;
+	size_t size;		/* Up to the index */
+	const unsigned char *index;
+	uint64_t n_boards;
+	void *handle;		/* What board_bin_load() mapped or read */
+	size_t handle_size;
+};
+
+int board_bin_writer_init(struct board_bin_writer *writer, FILE *out);
+int board_bin_write(struct board_bin_writer *writer, const struct minesweeper_board *board, int mines);
+int board_bin_writer_finish(struct board_bin_writer *writer);
+
+int board_bin_open(struct board_bin *bin, const void *data, size_t size);
+int board_bin_load(struct board_bin *bin, FILE *file);
+void board_bin_close(struct board_bin *bin);
+int board_bin_read(const struct board_bin *bin, uint64_t i, struct minesweeper_board *board, int *mines);
+
 #define BOARD_SOLVE_SUCCESS	0
 #define BOARD_SOLVE_PARTIAL	1
 #define BOARD_SOLVE_MUST_GUESS	2
@@ -74,7 +153,37 @@ int board_print(const struct minesweeper_board *board, FILE *out);
 #define BOARD_SOLVE_TILE_NOTHING	1
 #define BOARD_SOLVE_TILE_ERROR		2
 
-int board_solve_full(struct minesweeper_board *board, int row, int col);
-void board_deduce_partial(struct minesweeper_board *board);
+/* The rules board_deduce_partial() is made of, cheapest first */
+enum board_stage {
+	BOARD_STAGE_SIMPLE,
+	BOARD_STAGE_PAIRS,
+	BOARD_STAGE_WINDOWS,
+	BOARD_STAGE_FRONTIER,
+	BOARD_N_STAGES
+};
+
+/* A stage only runs once every stage before it has nothing left to deduce.
+ * Whenever one deduces anything, it is back to the first stage.
+ * */
+struct board_pipeline {
+	int n_stages;
+	enum board_stage stages[BOARD_N_STAGES];
+};
+
+extern const char *const board_stage_names[BOARD_N_STAGES];
+
+void board_pipeline_init(struct board_pipeline *pipeline);
+int board_pipeline_parse(struct board_pipeline *pipeline, const char *list);
+
+/* Both append everything they have to say to out */
+int board_solve_full(struct minesweeper_board *board, int row, int col, struct gr_buffer *out);
+int board_deduce_partial(struct minesweeper_board *board, struct gr_buffer *out);
+
+int board_deduce_simple(struct minesweeper_board *board);
+int board_deduce_pairs(struct minesweeper_board *board);
+int board_deduce_windows(struct minesweeper_board *board);
+int board_deduce_frontier(struct minesweeper_board *board);
+int board_deduce_windows_around(struct minesweeper_board *board, int row, int col);
+int board_deduce_window(struct minesweeper_board *board, int row, int col);
 
 #endif /* MINESWEEPER_SOLVER_H */
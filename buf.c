@@ -1,34 +1,56 @@
 #include "buf.h"
 
+#include <errno.h>
 #include <stdarg.h>
+#include <unistd.h>
+
+/* Anything printed in one go that is longer than this takes a trip to the
+ * heap
+ * */
+#define BUF_PRINTF_STACK 256
 
 int buf_printf(struct gr_buffer *buf, const char *fmt, ...)
 {
 	va_list args;
+	int ret;
 
 	va_start(args, fmt);
-	return buf_vaprintf(buf, fmt, args);
+	ret = buf_vaprintf(buf, fmt, args);
+	va_end(args);
+
+	return ret;
 }
 
 int buf_vaprintf(struct gr_buffer *buf, const char *fmt, va_list args)
 {
+	char stackbuf[BUF_PRINTF_STACK];
 	va_list arg_copy;
 	int chars_to_print;
 	char *printbuf;
 
 	va_copy(arg_copy, args);
-
-	chars_to_print = vsnprintf(NULL, 0, fmt, args);
-	va_end(args);
+	chars_to_print = vsnprintf(stackbuf, sizeof(stackbuf), fmt, args);
 
 	if (chars_to_print < 0) {
 		va_end(arg_copy);
 		return -1;
 	}
 
+	if ((size_t)chars_to_print < sizeof(stackbuf)) {
+		va_end(arg_copy);
+		gr_buf_append(buf, stackbuf, chars_to_print);
+		return chars_to_print;
+	}
+
 	printbuf = malloc(chars_to_print + 1);
-	va_end(arg_copy);
+
+	if (!printbuf) {
+		va_end(arg_copy);
+		return -1;
+	}
+
 	chars_to_print = vsnprintf(printbuf, chars_to_print + 1, fmt, arg_copy);
+	va_end(arg_copy);
 	gr_buf_append(buf, printbuf, chars_to_print);
 
 	free(printbuf);
@@ -36,14 +58,27 @@ int buf_vaprintf(struct gr_buffer *buf, const char *fmt, va_list args)
 	return chars_to_print;
 }
 
+/* Goes around stdio so that the whole buffer is handed to the kernel at
+ * once. Whatever stdio is still holding on to for out is flushed first to
+ * keep things in order.
+ * */
 void buf_write(const struct gr_buffer *buf, FILE *out)
 {
-	size_t written = 0;
 	size_t total = 0;
+	ssize_t written;
+
+	fflush(out);
+
+	while (total < buf->length) {
+		written = write(fileno(out), buf->buf + total, buf->length - total);
+
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+
+			return;
+		}
 
-	do {
-		written = fwrite(buf->buf, 1, buf->length, out);
 		total += written;
-	} while (total < buf->length);
+	}
 }
-
@@ -5,6 +5,9 @@
 
 #include <gramas/buf.h>
 
+/* Appends a string literal, its length known at compile time */
+#define BUF_APPEND_STR(__buf, __str) do { gr_buf_append(__buf, __str, sizeof(__str) - 1); } while (0)
+
 int buf_printf(struct gr_buffer *buf, const char *fmt, ...);
 int buf_vaprintf(struct gr_buffer *buf, const char *fmt, va_list args);
 void buf_write(const struct gr_buffer *buf, FILE *out);
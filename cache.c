@@ -0,0 +1,79 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "cache.h"
+
+static size_t deduce_cache_slot(const struct deduce_cache *cache, const struct deduce_cache_key *key);
+
+/* size is rounded up to a power of two */
+int deduce_cache_init(struct deduce_cache *cache, size_t size)
+{
+	size_t capacity = 1;
+
+	while (capacity < size)
+		capacity *= 2;
+
+	memset(cache, 0, sizeof(*cache));
+	cache->entries = calloc(capacity, sizeof(cache->entries[0]));
+
+	if (!cache->entries)
+		return 1;
+
+	cache->mask = capacity - 1;
+
+	return 0;
+}
+
+void deduce_cache_destroy(struct deduce_cache *cache)
+{
+	free(cache->entries);
+	memset(cache, 0, sizeof(*cache));
+}
+
+int deduce_cache_lookup(struct deduce_cache *cache,
+		const struct deduce_cache_key *key,
+		struct deduce_cache_result *result)
+{
+	struct deduce_cache_entry *entry;
+
+	entry = &cache->entries[deduce_cache_slot(cache, key)];
+
+	if (!entry->used
+			|| entry->key.lower_bounds != key->lower_bounds
+			|| entry->key.upper_bounds != key->upper_bounds
+			|| entry->key.window != key->window) {
+		cache->misses++;
+		return 0;
+	}
+
+	cache->hits++;
+	*result = entry->result;
+
+	return 1;
+}
+
+void deduce_cache_store(struct deduce_cache *cache,
+		const struct deduce_cache_key *key,
+		const struct deduce_cache_result *result)
+{
+	struct deduce_cache_entry *entry;
+
+	entry = &cache->entries[deduce_cache_slot(cache, key)];
+	entry->key = *key;
+	entry->result = *result;
+	entry->used = 1;
+}
+
+static size_t deduce_cache_slot(const struct deduce_cache *cache, const struct deduce_cache_key *key)
+{
+	uint64_t h;
+
+	h = key->lower_bounds * 0x9E3779B97F4A7C15ULL;
+	h ^= key->upper_bounds + 0xC2B2AE3D27D4EB4FULL + (h << 6) + (h >> 2);
+	h ^= key->window + 0x165667B19E3779F9ULL + (h << 6) + (h >> 2);
+	h ^= h >> 29;
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 32;
+
+	return (size_t)h & cache->mask;
+}
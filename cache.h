@@ -0,0 +1,47 @@
+#ifndef MINESWEEPER_SOLVER_CACHE_H
+#define MINESWEEPER_SOLVER_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define DEDUCE_CACHE_DEFAULT_SIZE	(1 << 12)
+
+/* Everything the outcome of enumerating one 3x3 window depends on. */
+struct deduce_cache_key {
+	uint64_t lower_bounds;
+	uint64_t upper_bounds;
+	uint32_t window;	/* Unknown and mine masks, missing mine count */
+};
+
+struct deduce_cache_result {
+	uint16_t always_mine;
+	uint16_t always_clear;
+	unsigned char viable;
+};
+
+struct deduce_cache_entry {
+	struct deduce_cache_key key;
+	struct deduce_cache_result result;
+	unsigned char used;
+};
+
+/* Direct mapped cache of 3x3 window deductions. A colliding entry simply
+ * replaces whatever was in its slot.
+ * */
+struct deduce_cache {
+	struct deduce_cache_entry *entries;
+	size_t mask;
+	unsigned long hits;
+	unsigned long misses;
+};
+
+int deduce_cache_init(struct deduce_cache *cache, size_t size);
+void deduce_cache_destroy(struct deduce_cache *cache);
+int deduce_cache_lookup(struct deduce_cache *cache,
+		const struct deduce_cache_key *key,
+		struct deduce_cache_result *result);
+void deduce_cache_store(struct deduce_cache *cache,
+		const struct deduce_cache_key *key,
+		const struct deduce_cache_result *result);
+
+#endif /* MINESWEEPER_SOLVER_CACHE_H */
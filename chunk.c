@@ -0,0 +1,308 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "chunk.h"
+
+#define CHUNK_TABLE_INITIAL 64
+
+/* Tile coordinates to chunks and offsets within them. Chunks are rounded
+ * towards minus infinity, without right shifting negative numbers.
+ * */
+#define CHUNK_OF(__n)		((__n) >= 0 ? (__n) >> CHUNK_BITS : ~(~(__n) >> CHUNK_BITS))
+#define CHUNK_OFFSET(__n)	((int)((__n) & (CHUNK_SIZE - 1)))
+
+static struct board_chunk *chunked_board_find(const struct chunked_board *board, int64_t row, int64_t col);
+static struct board_chunk *chunked_board_add(struct chunked_board *board, int64_t row, int64_t col);
+static int chunked_board_grow(struct chunked_board *board);
+static size_t chunk_slot(const struct chunked_board *board, int64_t row, int64_t col);
+
+int chunked_board_init(struct chunked_board *board)
+{
+	memset(board, 0, sizeof(*board));
+	board->slots = calloc(CHUNK_TABLE_INITIAL, sizeof(board->slots[0]));
+
+	if (!board->slots)
+		return 1;
+
+	board->mask = CHUNK_TABLE_INITIAL - 1;
+
+	return 0;
+}
+
+void chunked_board_destroy(struct chunked_board *board)
+{
+	size_t i;
+
+	if (board->slots)
+		for (i = 0; i <= board->mask; i++)
+			free(board->slots[i]);
+
+	free(board->slots);
+	memset(board, 0, sizeof(*board));
+}
+
+/* Anything never stored is unknown */
+unsigned char chunked_board_get(const struct chunked_board *board, int64_t row, int64_t col)
+{
+	const struct board_chunk *chunk;
+
+	chunk = chunked_board_find(board, CHUNK_OF(row), CHUNK_OF(col));
+
+	if (!chunk)
+		return TILE_UNKNOWN;
+
+	return chunk->tiles[CHUNK_OFFSET(row) * CHUNK_SIZE + CHUNK_OFFSET(col)];
+}
+
+int chunked_board_set(struct chunked_board *board, int64_t row, int64_t col, unsigned char tile)
+{
+	struct board_chunk *chunk;
+
+	chunk = chunked_board_find(board, CHUNK_OF(row), CHUNK_OF(col));
+
+	if (!chunk) {
+		if (tile == TILE_UNKNOWN)
+			return 0;
+
+		chunk = chunked_board_add(board, CHUNK_OF(row), CHUNK_OF(col));
+
+		if (!chunk)
+			return 1;
+	}
+
+	chunk->tiles[CHUNK_OFFSET(row) * CHUNK_SIZE + CHUNK_OFFSET(col)] = tile;
+
+	return 0;
+}
+
+/* Copies the rows x cols tiles starting at row, col into window, which gets
+ * initialized. Tiles past the edge of the window become TILE_OUTSIDE, so
+ * numbers on the edge of the window see fewer neighbors than they really
+ * have. See chunked_board_load_around() for windows that are safe to deduce
+ * on as they are.
+ * */
+int chunked_board_load(const struct chunked_board *board, int64_t row, int64_t col,
+		int rows, int cols, struct minesweeper_board *window)
+{
+	const struct board_chunk *chunk;
+	unsigned char *tiles;
+	int64_t r;
+	int64_t c;
+	int span;
+	int i;
+	int j;
+
+	if (rows <= 0 || cols <= 0)
+		return 1;
+
+	board_init(window, rows, cols);
+
+	/* One lookup per chunk a row of the window crosses */
+	for (i = 0; i < rows; i++) {
+		r = row + i;
+		tiles = &BOARD_AT(window, i, 0);
+
+		for (j = 0; j < cols; j += span) {
+			c = col + j;
+			span = CHUNK_SIZE - CHUNK_OFFSET(c);
+
+			if (span > cols - j)
+				span = cols - j;
+
+			chunk = chunked_board_find(board, CHUNK_OF(r), CHUNK_OF(c));
+
+			if (chunk)
+				memcpy(tiles + j, &chunk->tiles[CHUNK_OFFSET(r) * CHUNK_SIZE + CHUNK_OFFSET(c)], span);
+		}
+	}
+
+	return 0;
+}
+
+/* Puts what was deduced on a window loaded from row, col back. Only tiles
+ * still unknown on the board are written, since anything already known
+ * cannot change; chunked_board_set() is for that. Parts of the window that
+ * are all unknown do not get chunks allocated for them.
+ * */
+int chunked_board_store(struct chunked_board *board, int64_t row, int64_t col,
+		const struct minesweeper_board *window)
+{
+	struct board_chunk *chunk;
+	const unsigned char *tiles;
+	unsigned char *dst;
+	int64_t r;
+	int64_t c;
+	int span;
+	int i;
+	int j;
+	int k;
+
+	for (i = 0; i < window->rows; i++) {
+		r = row + i;
+		tiles = &BOARD_AT(window, i, 0);
+
+		for (j = 0; j < window->cols; j += span) {
+			c = col + j;
+			span = CHUNK_SIZE - CHUNK_OFFSET(c);
+
+			if (span > window->cols - j)
+				span = window->cols - j;
+
+			chunk = chunked_board_find(board, CHUNK_OF(r), CHUNK_OF(c));
+
+			if (!chunk) {
+				for (k = 0; k < span && tiles[j + k] == TILE_UNKNOWN; k++)
+					;
+
+				if (k == span)
+					continue;
+
+				chunk = chunked_board_add(board, CHUNK_OF(r), CHUNK_OF(c));
+
+				if (!chunk)
+					return 1;
+			}
+
+			dst = &chunk->tiles[CHUNK_OFFSET(r) * CHUNK_SIZE + CHUNK_OFFSET(c)];
+
+			for (k = 0; k < span; k++)
+				if (TILE_IS_OPEN(dst[k]))
+					dst[k] = tiles[j + k];
+		}
+	}
+
+	return 0;
+}
+
+/* Loads the window within radius tiles of row, col, plus one more ring.
+ * Numbers in that ring cannot see all of their neighbors, so they are loaded
+ * as clear tiles that say nothing. Whatever the rules deduce on the window
+ * then holds for the whole board. The window starts at *window_row,
+ * *window_col, which is what chunked_board_store() wants back.
+ * */
+int chunked_board_load_around(const struct chunked_board *board, int64_t row, int64_t col,
+		int radius, struct minesweeper_board *window, int64_t *window_row, int64_t *window_col)
+{
+	int size = 2 * radius + 3;
+	unsigned char *tile;
+	int i;
+
+	if (radius < 0)
+		return 1;
+
+	*window_row = row - radius - 1;
+	*window_col = col - radius - 1;
+
+	if (chunked_board_load(board, *window_row, *window_col, size, size, window))
+		return 1;
+
+	for (i = 0; i < 4 * (size - 1); i++) {
+		if (i < size - 1)
+			tile = &BOARD_AT(window, 0, i);
+		else if (i < 2 * (size - 1))
+			tile = &BOARD_AT(window, i - (size - 1), size - 1);
+		else if (i < 3 * (size - 1))
+			tile = &BOARD_AT(window, size - 1, 3 * (size - 1) - i);
+		else
+			tile = &BOARD_AT(window, 4 * (size - 1) - i, 0);
+
+		if (*tile <= 8)
+			*tile = TILE_DEDUCED_CLEAR;
+	}
+
+	return 0;
+}
+
+static struct board_chunk *chunked_board_find(const struct chunked_board *board, int64_t row, int64_t col)
+{
+	struct board_chunk *chunk;
+	size_t slot;
+
+	for (slot = chunk_slot(board, row, col); (chunk = board->slots[slot]); slot = (slot + 1) & board->mask)
+		if (chunk->row == row && chunk->col == col)
+			return chunk;
+
+	return NULL;
+}
+
+/* Starts out all unknown */
+static struct board_chunk *chunked_board_add(struct chunked_board *board, int64_t row, int64_t col)
+{
+	struct board_chunk *chunk;
+	size_t slot;
+
+	/* Kept at most half full */
+	if (2 * (board->n_chunks + 1) > board->mask + 1 && chunked_board_grow(board))
+		return NULL;
+
+	chunk = malloc(sizeof(*chunk));
+
+	if (!chunk)
+		return NULL;
+
+	chunk->row = row;
+	chunk->col = col;
+	memset(chunk->tiles, TILE_UNKNOWN, sizeof(chunk->tiles));
+
+	for (slot = chunk_slot(board, row, col); board->slots[slot]; slot = (slot + 1) & board->mask)
+		;
+
+	board->slots[slot] = chunk;
+
+	if (!board->n_chunks++) {
+		board->min_row = board->max_row = row;
+		board->min_col = board->max_col = col;
+	}
+
+	if (row < board->min_row) board->min_row = row;
+	if (row > board->max_row) board->max_row = row;
+	if (col < board->min_col) board->min_col = col;
+	if (col > board->max_col) board->max_col = col;
+
+	return chunk;
+}
+
+static int chunked_board_grow(struct chunked_board *board)
+{
+	struct board_chunk **old = board->slots;
+	size_t old_mask = board->mask;
+	size_t slot;
+	size_t i;
+
+	board->slots = calloc(2 * (old_mask + 1), sizeof(board->slots[0]));
+
+	if (!board->slots) {
+		board->slots = old;
+		return 1;
+	}
+
+	board->mask = 2 * (old_mask + 1) - 1;
+
+	for (i = 0; i <= old_mask; i++) {
+		if (!old[i])
+			continue;
+
+		for (slot = chunk_slot(board, old[i]->row, old[i]->col); board->slots[slot];
+				slot = (slot + 1) & board->mask)
+			;
+
+		board->slots[slot] = old[i];
+	}
+
+	free(old);
+
+	return 0;
+}
+
+static size_t chunk_slot(const struct chunked_board *board, int64_t row, int64_t col)
+{
+	uint64_t h;
+
+	h = (uint64_t)row * 0x9E3779B97F4A7C15ULL;
+	h ^= (uint64_t)col + 0xC2B2AE3D27D4EB4FULL + (h << 6) + (h >> 2);
+	h ^= h >> 29;
+	h *= 0xBF58476D1CE4E5B9ULL;
+	h ^= h >> 32;
+
+	return (size_t)h & board->mask;
+}
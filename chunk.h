@@ -0,0 +1,51 @@
+#ifndef MINESWEEPER_SOLVER_CHUNK_H
+#define MINESWEEPER_SOLVER_CHUNK_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "board.h"
+
+#define CHUNK_BITS	6
+#define CHUNK_SIZE	(1 << CHUNK_BITS)
+
+struct board_chunk {
+	int64_t row;		/* Position in chunks, not tiles */
+	int64_t col;
+	unsigned char tiles[CHUNK_SIZE * CHUNK_SIZE];
+};
+
+/* Board without edges, stored as CHUNK_SIZE x CHUNK_SIZE chunks in an open
+ * addressing hash table. Chunks only get allocated once something other
+ * than TILE_UNKNOWN is stored in them, so memory follows what has been
+ * explored rather than how far apart it is.
+ *
+ * The rules work on dense boards. chunked_board_load() copies a window out
+ * to deduce on and chunked_board_store() puts the outcome back.
+ * */
+struct chunked_board {
+	struct board_chunk **slots;
+	size_t mask;
+	size_t n_chunks;
+
+	/* Chunks allocated so far lie within these, inclusive. Only valid
+	 * when there are any.
+	 * */
+	int64_t min_row;
+	int64_t min_col;
+	int64_t max_row;
+	int64_t max_col;
+};
+
+int chunked_board_init(struct chunked_board *board);
+void chunked_board_destroy(struct chunked_board *board);
+unsigned char chunked_board_get(const struct chunked_board *board, int64_t row, int64_t col);
+int chunked_board_set(struct chunked_board *board, int64_t row, int64_t col, unsigned char tile);
+int chunked_board_load(const struct chunked_board *board, int64_t row, int64_t col,
+		int rows, int cols, struct minesweeper_board *window);
+int chunked_board_store(struct chunked_board *board, int64_t row, int64_t col,
+		const struct minesweeper_board *window);
+int chunked_board_load_around(const struct chunked_board *board, int64_t row, int64_t col,
+		int radius, struct minesweeper_board *window, int64_t *window_row, int64_t *window_col);
+
+#endif /* MINESWEEPER_SOLVER_CHUNK_H */
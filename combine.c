@@ -1,43 +1,71 @@
+#if defined(__BMI2__)
+#	include <immintrin.h>
+#endif
+
+#include "bits.h"
 #include "combine.h"
 
-void n_choose_k_init(struct n_choose_k_uc_itr *itr, unsigned char nitems, unsigned char nchoices)
+static uint32_t deposit_bits(uint32_t bits, uint32_t mask);
+
+void mask_choose_init(struct mask_choose_itr *itr, uint32_t set, int k)
 {
-	unsigned char i;
+	int n;
+
+	n = popcount(set);
 
-	if (nchoices > nitems) {
+	if (k < 0 || k > n) {
 		itr->state = N_CHOOSE_K_DONE;
 		return;
 	}
 
-	itr->nitems = nitems;
-	itr->nchoices = nchoices;
+	itr->set = set;
+	itr->rank = ((uint32_t)1 << k) - 1;
+	itr->end = (uint32_t)1 << n;
+	itr->mask = deposit_bits(itr->rank, set);
 	itr->state = N_CHOOSE_K_HAS_NEXT;
-
-	for (i = 0; i < itr->nchoices; i++)
-		itr->choices[i] = i;
 }
 
-void n_choose_k_next(struct n_choose_k_uc_itr *itr)
+void mask_choose_next(struct mask_choose_itr *itr)
 {
-	unsigned char i;
-
-	i = itr->nchoices - 1;
+	uint32_t lowest;
+	uint32_t ripple;
 
 	if (itr->state == N_CHOOSE_K_DONE)
 		return;
 
-	while (itr->choices[i] >= itr->nitems - itr->nchoices + i && i > 0)
-		i--;
+	/* Choosing nothing has exactly one outcome */
+	if (!itr->rank) {
+		itr->state = N_CHOOSE_K_DONE;
+		return;
+	}
+
+	/* Gosper's hack: next larger integer with as many bits set */
+	lowest = itr->rank & -itr->rank;
+	ripple = itr->rank + lowest;
+	itr->rank = (((ripple ^ itr->rank) >> 2) / lowest) | ripple;
 
-	if (i == 0 && itr->choices[i] >= itr->nitems - itr->nchoices) {
+	if (itr->rank >= itr->end) {
 		itr->state = N_CHOOSE_K_DONE;
 		return;
 	}
 
-	itr->choices[i]++;
+	itr->mask = deposit_bits(itr->rank, itr->set);
+}
+
+/* Puts the lowest bits of bits into the positions of set bits of mask, lowest
+ * first. Same thing as the BMI2 PDEP instruction.
+ * */
+static uint32_t deposit_bits(uint32_t bits, uint32_t mask)
+{
+#if defined(__BMI2__)
+	return _pdep_u32(bits, mask);
+#else
+	uint32_t ret = 0;
 
-	for (; i < itr->nchoices - 1; i++)
-		itr->choices[i + 1] = itr->choices[i] + 1;
+	for (; mask && bits; mask &= mask - 1, bits >>= 1)
+		if (bits & 1)
+			ret |= mask & -mask;
 
-	return;
+	return ret;
+#endif
 }
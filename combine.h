@@ -1,27 +1,29 @@
 #ifndef MINESWEEPER_SOLVER_COMBINE_H
 #define MINESWEEPER_SOLVER_COMBINE_H
 
+#include <stdint.h>
+
 #define N_CHOOSE_K_DONE		0
 #define N_CHOOSE_K_HAS_NEXT	1
 
-struct n_choose_k_uc_itr {
-	unsigned char nitems;
-	unsigned char nchoices;
+/* Walks every subset of a bitmask that has exactly k bits set, yielding the
+ * subsets themselves as masks. Internally the k-subsets of {0 .. n - 1} are
+ * stepped through with Gosper's hack and scattered onto the bits of the set.
+ * */
+struct mask_choose_itr {
+	uint32_t set;
+	uint32_t rank;		/* k bits out of the lowest popcount(set) */
+	uint32_t end;
+	uint32_t mask;		/* Current subset of set */
 	unsigned char state;
-
-	/* Unique combination of choices of integers between 0 and nitems - 1.
-	 * Use these as indices into external array of things you are choosing
-	 * between.
-	 * */
-	unsigned char choices[0xFF];
 };
 
-void n_choose_k_init(struct n_choose_k_uc_itr *itr, unsigned char nitems, unsigned char nchoices);
-void n_choose_k_next(struct n_choose_k_uc_itr *itr);
+void mask_choose_init(struct mask_choose_itr *itr, uint32_t set, int k);
+void mask_choose_next(struct mask_choose_itr *itr);
 
-#define FOREACH_N_CHOOSE_K(__itr, __items, __choices)	\
-	for (n_choose_k_init((__itr), (__items), (__choices));	\
+#define FOREACH_MASK_CHOOSE_K(__itr, __set, __k)	\
+	for (mask_choose_init((__itr), (__set), (__k));	\
 				(__itr)->state == N_CHOOSE_K_HAS_NEXT;	\
-				n_choose_k_next((__itr)))
+				mask_choose_next((__itr)))
 
 #endif /* MINESWEEPER_SOLVER_COMBINE_H */
@@ -0,0 +1,226 @@
+#include <stdlib.h>
+
+#include "count.h"
+#include "frontier.h"
+
+static int count_layout(
+		const struct frontier *frontier,
+		const struct frontier_component *component,
+		const unsigned char *mines,
+		int n_mines,
+		void *ctx);
+static int count_numbers_fit(const struct minesweeper_board *board);
+static struct bignum *count_bignums(int n);
+static void count_bignums_destroy(struct bignum *nums, int n);
+
+/* Counts the layouts of mines that agree with the board exactly, or if
+ * total_mines is not -1, those that also hold that many mines in all.
+ *
+ * Components of the frontier are enumerated on their own, counting layouts
+ * by how many mines they hold, which fits 64 bits as every one of them is
+ * visited. Their counts are convolved into those of the whole frontier and
+ * a frontier layout with m mines is then completed by the interior tiles in
+ * C(interior, total_mines - known - m) ways, or 2^interior if the total is
+ * not known. Returns non-zero if memory runs out.
+ * */
+int count_solutions(const struct minesweeper_board *board, int total_mines, struct bignum *count)
+{
+	const struct frontier_component *component;
+	struct frontier frontier;
+	struct bignum *prefix = NULL;
+	struct bignum *next = NULL;
+	struct bignum *swap;
+	struct bignum factors[2];
+	uint64_t *layouts = NULL;
+	int prefix_len = 1;
+	int remaining;
+	int ret = 1;
+	int n;
+	int c;
+	int j;
+	int k;
+	int m;
+
+	bignum_init(&factors[0]);
+	bignum_init(&factors[1]);
+
+	if (bignum_set_u64(count, 0))
+		return 1;
+
+	/* Numbers with no unknown tiles around them are not on the frontier */
+	if (!count_numbers_fit(board))
+		return 0;
+
+	if (frontier_build(&frontier, board))
+		return 1;
+
+	prefix = count_bignums(frontier.n_cells + 1);
+	next = count_bignums(frontier.n_cells + 1);
+	layouts = malloc((frontier.n_cells + 1) * sizeof(layouts[0]));
+
+	if (!prefix || !next || !layouts || bignum_set_u64(&prefix[0], 1))
+		goto end;
+
+	for (c = 0; c < frontier.n_components; c++) {
+		component = &frontier.components[c];
+		n = component->n_cells;
+
+		for (k = 0; k <= n; k++)
+			layouts[k] = 0;
+
+		if (frontier_enumerate(&frontier, component, NULL, count_layout, layouts))
+			goto end;
+
+		for (m = 0; m < prefix_len + n; m++)
+			next[m].n_limbs = 0;
+
+		for (k = 0; k <= n; k++) {
+			if (!layouts[k])
+				continue;
+
+			if (bignum_set_u64(&factors[0], layouts[k]))
+				goto end;
+
+			for (m = 0; m < prefix_len; m++)
+				if (bignum_add_mul(&next[m + k], &prefix[m], &factors[0]))
+					goto end;
+		}
+
+		swap = prefix;
+		prefix = next;
+		next = swap;
+		prefix_len += n;
+	}
+
+	if (total_mines < 0) {
+		/* Every interior tile may or may not hold a mine */
+		if (bignum_set_u64(&factors[0], 1))
+			goto end;
+
+		for (j = 0; j < frontier.n_interior; j++)
+			if (bignum_mul_u32(&factors[0], 2))
+				goto end;
+
+		for (m = 0; m < prefix_len; m++)
+			if (bignum_add_mul(count, &prefix[m], &factors[0]))
+				goto end;
+
+		ret = 0;
+		goto end;
+	}
+
+	remaining = total_mines - frontier.n_known_mines;
+
+	/* factors[1] = C(interior, j), for j mines in the interior and the
+	 * rest on the frontier
+	 * */
+	if (bignum_set_u64(&factors[1], 1))
+		goto end;
+
+	for (j = 0; j <= remaining && j <= frontier.n_interior; j++) {
+		if (j) {
+			if (bignum_mul_u32(&factors[1], frontier.n_interior - j + 1))
+				goto end;
+
+			bignum_div_u32(&factors[1], j);
+		}
+
+		m = remaining - j;
+
+		if (m < prefix_len && bignum_add_mul(count, &prefix[m], &factors[1]))
+			goto end;
+	}
+
+	ret = 0;
+
+end:
+	count_bignums_destroy(prefix, frontier.n_cells + 1);
+	count_bignums_destroy(next, frontier.n_cells + 1);
+	bignum_destroy(&factors[0]);
+	bignum_destroy(&factors[1]);
+	free(layouts);
+	frontier_destroy(&frontier);
+
+	return ret;
+}
+
+static int count_layout(
+		const struct frontier *frontier,
+		const struct frontier_component *component,
+		const unsigned char *mines,
+		int n_mines,
+		void *ctx)
+{
+	uint64_t *layouts = ctx;
+
+	(void)frontier;
+	(void)component;
+	(void)mines;
+
+	layouts[n_mines]++;
+
+	return 0;
+}
+
+/* Whether every number has room for its mines and no more than that many
+ * around it already
+ * */
+static int count_numbers_fit(const struct minesweeper_board *board)
+{
+	unsigned char *tile;
+	int mines;
+	int open;
+	int i;
+	int j;
+	int k;
+	int l;
+
+	for (i = 0; i < board->rows; i++) {
+		for (j = 0; j < board->cols; j++) {
+			if (BOARD_AT(board, i, j) > 8)
+				continue;
+
+			mines = 0;
+			open = 0;
+
+			BOARD_FOREACH_NEIGHBOR(board, i, j, k, l, tile) {
+				if (TILE_IS_KNOWN_MINE(*tile))
+					mines++;
+				else if (TILE_IS_OPEN(*tile))
+					open++;
+			}
+
+			if (mines > BOARD_AT(board, i, j) || mines + open < BOARD_AT(board, i, j))
+				return 0;
+		}
+	}
+
+	return 1;
+}
+
+static struct bignum *count_bignums(int n)
+{
+	struct bignum *nums = malloc(n * sizeof(nums[0]));
+	int i;
+
+	if (!nums)
+		return NULL;
+
+	for (i = 0; i < n; i++)
+		bignum_init(&nums[i]);
+
+	return nums;
+}
+
+static void count_bignums_destroy(struct bignum *nums, int n)
+{
+	int i;
+
+	if (!nums)
+		return;
+
+	for (i = 0; i < n; i++)
+		bignum_destroy(&nums[i]);
+
+	free(nums);
+}
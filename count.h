@@ -0,0 +1,9 @@
+#ifndef MINESWEEPER_SOLVER_COUNT_H
+#define MINESWEEPER_SOLVER_COUNT_H
+
+#include "bignum.h"
+#include "board.h"
+
+int count_solutions(const struct minesweeper_board *board, int total_mines, struct bignum *count);
+
+#endif /* MINESWEEPER_SOLVER_COUNT_H */
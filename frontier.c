@@ -0,0 +1,1027 @@
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "frontier.h"
+
+/* Fewer cells than this are not worth starting threads for */
+#define FRONTIER_PARALLEL_MIN_CELLS 256
+
+/* Components row reduced. Smaller ones are cheaper to enumerate, and the
+ * matrix is dense, one int64_t per cell and number.
+ * */
+#define FRONTIER_REDUCE_MIN_CELLS 32
+#define FRONTIER_REDUCE_MAX_CELLS 1024
+
+/* Search nodes a component gets to be decided by walking every layout
+ * before its cells are probed one at a time instead
+ * */
+#define FRONTIER_DECIDE_BUDGET (1L << 16)
+
+/* Search nodes probing gets per component, all cells together. Cells left
+ * when it runs out stay undecided for the cheaper rules.
+ * */
+#define FRONTIER_PROBE_BUDGET (1L << 20)
+
+/* Components bigger than this are not enumerated at all */
+#define FRONTIER_DECIDE_MAX_CELLS 1024
+
+/* Search nodes one call of frontier_decide_jobs() gets over all of its
+ * components. Those not yet started once it is spent are left undecided.
+ * */
+#define FRONTIER_DECIDE_TOTAL_BUDGET (1L << 24)
+
+/* Row reduction gives up on a component once coefficients get this big */
+#define FRONTIER_REDUCE_MAX_COEF ((int64_t)1 << 40)
+
+struct frontier_search_s {
+	const struct frontier *frontier;
+	const struct frontier_component *component;
+	frontier_solution_fn fn;
+	void *ctx;
+	unsigned char *mines;	/* Current layout, one entry per cell */
+	int *placed;		/* Mines placed around each constraint */
+	int *unassigned;	/* Cells not yet assigned around each constraint */
+	int n_mines;
+	int forced;		/* Cell held at forced_value throughout, -1 if none */
+	int forced_value;
+	long *budget;		/* Nodes left before giving up, NULL for no limit */
+};
+
+struct frontier_decide_s {
+	unsigned char *seen_mine;
+	unsigned char *seen_clear;
+	int undecided;
+	int viable;
+	int probing;		/* Stop at the first layout */
+	long spent;		/* Search nodes used by components so far */
+};
+
+/* Components are handed out one at a time, biggest first, to whichever
+ * thread asks next. Each only writes the verdicts and seen flags of its own
+ * cells, so nothing but the counter needs the lock.
+ * */
+struct frontier_pool_s {
+	const struct frontier *frontier;
+	unsigned char *verdicts;
+	unsigned char *seen_mine;
+	unsigned char *seen_clear;
+	const struct frontier_component **order;
+	int next;
+	int decided;
+	long spent;
+	pthread_mutex_t lock;
+};
+
+static int frontier_order(struct frontier *frontier);
+static int frontier_search(struct frontier_search_s *search, int depth);
+static int frontier_enumerate_forced(
+		const struct frontier *frontier,
+		const struct frontier_component *component,
+		int forced, int forced_value, long *budget,
+		frontier_solution_fn fn,
+		void *ctx);
+static int frontier_decide_component(const struct frontier *frontier,
+		const struct frontier_component *component,
+		struct frontier_decide_s *decide, unsigned char *verdicts);
+static void frontier_decide_skip(const struct frontier_component *component,
+		unsigned char *verdicts);
+static int frontier_decide_solution(
+		const struct frontier *frontier,
+		const struct frontier_component *component,
+		const unsigned char *mines,
+		int n_mines,
+		void *ctx);
+static void *frontier_decide_worker(void *arg);
+static int frontier_reduce_component(const struct frontier *frontier,
+		const struct frontier_component *component, unsigned char *verdicts);
+static int frontier_eliminate(int64_t **rows, int64_t *rhs, int *lo, int *hi, int n_rows, int n_cols);
+static int frontier_bound(int64_t **rows, const int64_t *rhs, const int *lo, const int *hi,
+		int n_rows, signed char *known);
+static int frontier_cross(int64_t x, int64_t a, int64_t y, int64_t b, int64_t *ret);
+static int64_t gcd64(int64_t a, int64_t b);
+static int frontier_component_cmp(const void *a, const void *b);
+
+/* Collects every unknown tile that borders a known number along with the
+ * numbers themselves and splits them into independent components. Returns
+ * non-zero if memory runs out.
+ * */
+int frontier_build(struct frontier *frontier, const struct minesweeper_board *board)
+{
+	struct frontier_constraint *constraint;
+	struct frontier_cell *cell;
+	unsigned char *tile;
+	int *cell_index;
+	int n_unknown = 0;
+	int n_numbers = 0;
+	int idx;
+	int i;
+	int j;
+	int k;
+	int l;
+
+	memset(frontier, 0, sizeof(*frontier));
+
+	for (i = 0; i < board->rows; i++) {
+		for (j = 0; j < board->cols; j++) {
+			if (TILE_IS_OPEN(BOARD_AT(board, i, j)))
+				n_unknown++;
+			else if (TILE_IS_KNOWN_MINE(BOARD_AT(board, i, j)))
+				frontier->n_known_mines++;
+			else if (BOARD_AT(board, i, j) <= 8)
+				n_numbers++;
+		}
+	}
+
+	frontier->n_interior = n_unknown;
+
+	if (!n_unknown || !n_numbers)
+		return 0;
+
+	cell_index = malloc(sizeof(cell_index[0]) * board->rows * board->cols);
+	frontier->cells = malloc(sizeof(frontier->cells[0]) * n_unknown);
+	frontier->constraints = malloc(sizeof(frontier->constraints[0]) * n_numbers);
+
+	if (!cell_index || !frontier->cells || !frontier->constraints) {
+		free(cell_index);
+		frontier_destroy(frontier);
+		return 1;
+	}
+
+	for (i = 0; i < board->rows * board->cols; i++)
+		cell_index[i] = -1;
+
+	for (i = 0; i < board->rows; i++) {
+		for (j = 0; j < board->cols; j++) {
+			if (BOARD_AT(board, i, j) > 8)
+				continue;
+
+			constraint = &frontier->constraints[frontier->n_constraints];
+			constraint->row = i;
+			constraint->col = j;
+			constraint->mines = BOARD_AT(board, i, j);
+			constraint->n_cells = 0;
+
+			BOARD_FOREACH_NEIGHBOR(board, i, j, k, l, tile) {
+				if (TILE_IS_KNOWN_MINE(*tile)) {
+					constraint->mines--;
+					continue;
+				}
+
+				if (!TILE_IS_OPEN(*tile))
+					continue;
+
+				idx = (i + k) * board->cols + j + l;
+
+				if (cell_index[idx] < 0) {
+					cell_index[idx] = frontier->n_cells;
+					cell = &frontier->cells[frontier->n_cells++];
+					cell->row = i + k;
+					cell->col = j + l;
+					cell->n_constraints = 0;
+				}
+
+				cell = &frontier->cells[cell_index[idx]];
+				cell->constraints[cell->n_constraints++] = frontier->n_constraints;
+				constraint->cells[constraint->n_cells++] = cell_index[idx];
+			}
+
+			if (constraint->n_cells)
+				frontier->n_constraints++;
+		}
+	}
+
+	free(cell_index);
+
+	frontier->n_interior -= frontier->n_cells;
+
+	if (frontier->n_cells && frontier_order(frontier)) {
+		frontier_destroy(frontier);
+		return 1;
+	}
+
+	return 0;
+}
+
+void frontier_destroy(struct frontier *frontier)
+{
+	free(frontier->cells);
+	free(frontier->constraints);
+	free(frontier->components);
+
+	memset(frontier, 0, sizeof(*frontier));
+}
+
+/* Renumbers cells and constraints in breadth first order, one component after
+ * another. Besides making components contiguous this places cells that share
+ * constraints next to each other, which lets the search reject a bad partial
+ * layout as early as possible. Returns non-zero if memory runs out, leaving
+ * the frontier as it was.
+ * */
+static int frontier_order(struct frontier *frontier)
+{
+	struct frontier_cell *cells;
+	struct frontier_constraint *constraints;
+	struct frontier_component *component;
+	int *cell_map;
+	int *constraint_map;
+	int *cell_order;
+	int *constraint_order;
+	int n_cells = 0;
+	int n_constraints = 0;
+	int ret = 1;
+	int start;
+	int cur;
+	int c;
+	int x;
+	int i;
+	int j;
+
+	cells = malloc(sizeof(cells[0]) * frontier->n_cells);
+	constraints = malloc(sizeof(constraints[0]) * frontier->n_constraints);
+	cell_map = malloc(sizeof(cell_map[0]) * frontier->n_cells);
+	cell_order = malloc(sizeof(cell_order[0]) * frontier->n_cells);
+	constraint_map = malloc(sizeof(constraint_map[0]) * frontier->n_constraints);
+	constraint_order = malloc(sizeof(constraint_order[0]) * frontier->n_constraints);
+	frontier->components = malloc(sizeof(frontier->components[0]) * frontier->n_cells);
+
+	if (!cells || !constraints || !cell_map || !cell_order || !constraint_map
+			|| !constraint_order || !frontier->components) {
+		free(cells);
+		free(constraints);
+		goto end;
+	}
+
+	for (i = 0; i < frontier->n_cells; i++)
+		cell_map[i] = -1;
+
+	for (i = 0; i < frontier->n_constraints; i++)
+		constraint_map[i] = -1;
+
+	for (start = 0; start < frontier->n_cells; start++) {
+		if (cell_map[start] >= 0)
+			continue;
+
+		component = &frontier->components[frontier->n_components++];
+		component->first_cell = n_cells;
+		component->first_constraint = n_constraints;
+
+		cell_map[start] = n_cells;
+		cell_order[n_cells++] = start;
+
+		for (cur = component->first_cell; cur < n_cells; cur++) {
+			for (i = 0; i < frontier->cells[cell_order[cur]].n_constraints; i++) {
+				c = frontier->cells[cell_order[cur]].constraints[i];
+
+				if (constraint_map[c] >= 0)
+					continue;
+
+				constraint_map[c] = n_constraints;
+				constraint_order[n_constraints++] = c;
+
+				for (j = 0; j < frontier->constraints[c].n_cells; j++) {
+					x = frontier->constraints[c].cells[j];
+
+					if (cell_map[x] >= 0)
+						continue;
+
+					cell_map[x] = n_cells;
+					cell_order[n_cells++] = x;
+				}
+			}
+		}
+
+		component->n_cells = n_cells - component->first_cell;
+		component->n_constraints = n_constraints - component->first_constraint;
+	}
+
+	for (i = 0; i < n_cells; i++) {
+		cells[i] = frontier->cells[cell_order[i]];
+
+		for (j = 0; j < cells[i].n_constraints; j++)
+			cells[i].constraints[j] = constraint_map[cells[i].constraints[j]];
+	}
+
+	for (i = 0; i < n_constraints; i++) {
+		constraints[i] = frontier->constraints[constraint_order[i]];
+
+		for (j = 0; j < constraints[i].n_cells; j++)
+			constraints[i].cells[j] = cell_map[constraints[i].cells[j]];
+	}
+
+	free(frontier->cells);
+	free(frontier->constraints);
+	frontier->cells = cells;
+	frontier->constraints = constraints;
+	ret = 0;
+
+end:
+	free(cell_map);
+	free(cell_order);
+	free(constraint_map);
+	free(constraint_order);
+
+	return ret;
+}
+
+/* Walks every mine layout of a component that agrees with all of its
+ * numbers. Cells are assigned in order and a branch is abandoned as soon as
+ * any constraint touching the last assigned cell has too many mines or can no
+ * longer get enough of them. Every node searched is taken off *budget, unless
+ * budget is NULL. Returns whatever non-zero fn returned to stop the walk, -1
+ * if memory or the budget runs out or 0 once every layout has been seen.
+ * */
+int frontier_enumerate(
+		const struct frontier *frontier,
+		const struct frontier_component *component,
+		long *budget,
+		frontier_solution_fn fn,
+		void *ctx)
+{
+	return frontier_enumerate_forced(frontier, component, -1, 0, budget, fn, ctx);
+}
+
+/* Same as frontier_enumerate(), but only walks the layouts in which cell
+ * forced of the component, if not -1, holds forced_value. The cell is placed
+ * before any other, so branches that clash with it are cut off early. Every
+ * node searched is taken off *budget, unless budget is NULL, and -1 is
+ * returned once it is used up. Running out of memory counts as running out of
+ * budget.
+ * */
+static int frontier_enumerate_forced(
+		const struct frontier *frontier,
+		const struct frontier_component *component,
+		int forced, int forced_value, long *budget,
+		frontier_solution_fn fn,
+		void *ctx)
+{
+	struct frontier_search_s search;
+	const struct frontier_constraint *constraint;
+	const struct frontier_cell *cell;
+	int ret = 0;
+	int c;
+	int i;
+
+	search.frontier = frontier;
+	search.component = component;
+	search.fn = fn;
+	search.ctx = ctx;
+	search.n_mines = 0;
+	search.forced = forced;
+	search.forced_value = forced_value;
+	search.budget = budget;
+	search.mines = calloc(component->n_cells, sizeof(search.mines[0]));
+	search.placed = calloc(component->n_constraints, sizeof(search.placed[0]));
+	search.unassigned = malloc(sizeof(search.unassigned[0]) * component->n_constraints);
+
+	if (!search.mines || !search.placed || !search.unassigned) {
+		ret = -1;
+		goto end;
+	}
+
+	for (i = 0; i < component->n_constraints; i++) {
+		constraint = &frontier->constraints[component->first_constraint + i];
+		search.unassigned[i] = constraint->n_cells;
+	}
+
+	if (forced >= 0) {
+		cell = &frontier->cells[component->first_cell + forced];
+		search.mines[forced] = forced_value;
+		search.n_mines = forced_value;
+
+		for (i = 0; i < cell->n_constraints; i++) {
+			c = cell->constraints[i] - component->first_constraint;
+			constraint = &frontier->constraints[cell->constraints[i]];
+			search.placed[c] += forced_value;
+			search.unassigned[c]--;
+
+			if (search.placed[c] > constraint->mines
+					|| search.placed[c] + search.unassigned[c] < constraint->mines)
+				goto end;
+		}
+	}
+
+	ret = frontier_search(&search, 0);
+
+end:
+	free(search.mines);
+	free(search.placed);
+	free(search.unassigned);
+
+	return ret;
+}
+
+static int frontier_search(struct frontier_search_s *search, int depth)
+{
+	const struct frontier_cell *cell;
+	const struct frontier_constraint *constraint;
+	int value;
+	int ret;
+	int c;
+	int i;
+
+	if (depth == search->component->n_cells) {
+		return search->fn(search->frontier, search->component,
+				search->mines, search->n_mines, search->ctx);
+	}
+
+	if (search->budget && (*search->budget)-- <= 0)
+		return -1;
+
+	if (depth == search->forced)
+		return frontier_search(search, depth + 1);
+
+	cell = &search->frontier->cells[search->component->first_cell + depth];
+
+	for (value = 0; value <= 1; value++) {
+		for (i = 0; i < cell->n_constraints; i++) {
+			c = cell->constraints[i] - search->component->first_constraint;
+			constraint = &search->frontier->constraints[cell->constraints[i]];
+
+			if (search->placed[c] + value > constraint->mines)
+				break;
+
+			if (search->placed[c] + value + search->unassigned[c] - 1 < constraint->mines)
+				break;
+		}
+
+		if (i < cell->n_constraints)
+			continue;
+
+		for (i = 0; i < cell->n_constraints; i++) {
+			c = cell->constraints[i] - search->component->first_constraint;
+			search->placed[c] += value;
+			search->unassigned[c]--;
+		}
+
+		search->mines[depth] = value;
+		search->n_mines += value;
+
+		ret = frontier_search(search, depth + 1);
+
+		search->n_mines -= value;
+		search->mines[depth] = 0;
+
+		for (i = 0; i < cell->n_constraints; i++) {
+			c = cell->constraints[i] - search->component->first_constraint;
+			search->placed[c] -= value;
+			search->unassigned[c]++;
+		}
+
+		if (ret)
+			return ret;
+	}
+
+	return 0;
+}
+
+/* Fills verdicts with FRONTIER_MINE for cells that hold a mine in every
+ * layout of their component, FRONTIER_CLEAR for cells that never do and
+ * FRONTIER_EITHER for the rest. Components without any consistent layout are
+ * left undecided, as are cells that would take too long to decide (see
+ * FRONTIER_PROBE_BUDGET and FRONTIER_DECIDE_TOTAL_BUDGET), so that a call
+ * always finishes in bounded time. Returns the number of decided cells.
+ * */
+int frontier_decide(const struct frontier *frontier, unsigned char *verdicts)
+{
+	return frontier_decide_jobs(frontier, verdicts, 1);
+}
+
+/* Same as frontier_decide() but spreads the components over up to jobs
+ * threads. Large frontiers only; small ones are not worth the threads.
+ * */
+int frontier_decide_jobs(const struct frontier *frontier, unsigned char *verdicts, int jobs)
+{
+	struct frontier_decide_s decide;
+	struct frontier_pool_s pool;
+	pthread_t *threads = NULL;
+	unsigned char *seen_mine;
+	unsigned char *seen_clear;
+	int started = 0;
+	int ret = 0;
+	int i;
+
+	if (!frontier->n_cells)
+		return 0;
+
+	seen_mine = calloc(frontier->n_cells, 1);
+	seen_clear = calloc(frontier->n_cells, 1);
+
+	/* Every component is left undecided */
+	if (!seen_mine || !seen_clear) {
+		free(seen_mine);
+		free(seen_clear);
+		memset(verdicts, FRONTIER_EITHER, frontier->n_cells);
+		return 0;
+	}
+
+	if (jobs > frontier->n_components)
+		jobs = frontier->n_components;
+
+	if (frontier->n_cells < FRONTIER_PARALLEL_MIN_CELLS)
+		jobs = 1;
+
+	if (jobs > 1) {
+		threads = malloc(sizeof(threads[0]) * (jobs - 1));
+		pool.order = malloc(sizeof(pool.order[0]) * frontier->n_components);
+	}
+
+	if (jobs <= 1 || !threads || !pool.order) {
+		if (jobs > 1) {
+			free(threads);
+			free(pool.order);
+		}
+
+		decide.seen_mine = seen_mine;
+		decide.seen_clear = seen_clear;
+		decide.spent = 0;
+
+		for (i = 0; i < frontier->n_components; i++) {
+			if (decide.spent < FRONTIER_DECIDE_TOTAL_BUDGET)
+				ret += frontier_decide_component(frontier, &frontier->components[i],
+						&decide, verdicts);
+			else
+				frontier_decide_skip(&frontier->components[i], verdicts);
+		}
+
+		free(seen_mine);
+		free(seen_clear);
+
+		return ret;
+	}
+
+	for (i = 0; i < frontier->n_components; i++)
+		pool.order[i] = &frontier->components[i];
+
+	qsort(pool.order, frontier->n_components, sizeof(pool.order[0]), frontier_component_cmp);
+
+	pool.frontier = frontier;
+	pool.verdicts = verdicts;
+	pool.seen_mine = seen_mine;
+	pool.seen_clear = seen_clear;
+	pool.next = 0;
+	pool.decided = 0;
+	pool.spent = 0;
+	pthread_mutex_init(&pool.lock, NULL);
+
+	/* This thread is the last worker */
+	for (i = 0; i < jobs - 1; i++)
+		if (!pthread_create(&threads[started], NULL, frontier_decide_worker, &pool))
+			started++;
+
+	frontier_decide_worker(&pool);
+
+	for (i = 0; i < started; i++)
+		pthread_join(threads[i], NULL);
+
+	pthread_mutex_destroy(&pool.lock);
+	free(seen_mine);
+	free(seen_clear);
+	free(pool.order);
+	free(threads);
+
+	return pool.decided;
+}
+
+static void *frontier_decide_worker(void *arg)
+{
+	struct frontier_pool_s *pool = arg;
+	const struct frontier_component *component;
+	struct frontier_decide_s decide;
+	int decided = 0;
+	long spent;
+
+	decide.seen_mine = pool->seen_mine;
+	decide.seen_clear = pool->seen_clear;
+
+	for (;;) {
+		pthread_mutex_lock(&pool->lock);
+		component = pool->next < pool->frontier->n_components ? pool->order[pool->next++] : NULL;
+		spent = pool->spent;
+		pthread_mutex_unlock(&pool->lock);
+
+		if (!component)
+			break;
+
+		if (spent >= FRONTIER_DECIDE_TOTAL_BUDGET) {
+			frontier_decide_skip(component, pool->verdicts);
+			continue;
+		}
+
+		decide.spent = 0;
+		decided += frontier_decide_component(pool->frontier, component, &decide, pool->verdicts);
+
+		pthread_mutex_lock(&pool->lock);
+		pool->spent += decide.spent;
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	pthread_mutex_lock(&pool->lock);
+	pool->decided += decided;
+	pthread_mutex_unlock(&pool->lock);
+
+	return NULL;
+}
+
+/* Biggest components first, so that no thread is left with a big one at the
+ * end while the others have run out of work
+ * */
+static int frontier_component_cmp(const void *a, const void *b)
+{
+	int size_a = (*(const struct frontier_component *const *)a)->n_cells;
+	int size_b = (*(const struct frontier_component *const *)b)->n_cells;
+
+	return (size_a < size_b) - (size_a > size_b);
+}
+
+/* Walking every layout stops as soon as every cell has been seen both ways,
+ * but the first cells only get their second value once the whole subtree
+ * below them is exhausted. Components that take too long for that are
+ * probed instead: every cell not yet seen both ways is forced the other way
+ * and one layout is looked for. Each layout found settles the cells it shows
+ * both ways, so mostly only cells that are in fact decided take a search
+ * that comes up empty.
+ *
+ * Probing shares one budget across the component. A probe cut short counts
+ * as having found a layout, so whatever is left once it runs out stays
+ * undecided, as does every cell of a component that is too big.
+ * */
+static int frontier_decide_component(const struct frontier *frontier,
+		const struct frontier_component *component,
+		struct frontier_decide_s *decide, unsigned char *verdicts)
+{
+	long budget = FRONTIER_DECIDE_BUDGET;
+	int ret = 0;
+	int i;
+	int j;
+
+	decide->undecided = component->n_cells;
+	decide->viable = 0;
+	decide->probing = 0;
+
+	if (component->n_cells <= FRONTIER_DECIDE_MAX_CELLS
+			&& frontier_enumerate_forced(frontier, component, -1, 0, &budget,
+				frontier_decide_solution, decide) < 0) {
+		decide->probing = 1;
+		decide->spent += FRONTIER_DECIDE_BUDGET;
+		budget = FRONTIER_PROBE_BUDGET;
+
+		if (!decide->viable)
+			frontier_enumerate_forced(frontier, component, -1, 0, &budget,
+					frontier_decide_solution, decide);
+	}
+
+	for (i = 0; i < component->n_cells; i++) {
+		j = component->first_cell + i;
+		verdicts[j] = FRONTIER_EITHER;
+
+		if (!decide->viable)
+			continue;
+
+		if (!decide->seen_clear[j] && (!decide->probing
+					|| !frontier_enumerate_forced(frontier, component, i, 0, &budget,
+						frontier_decide_solution, decide))) {
+			verdicts[j] = FRONTIER_MINE;
+			ret++;
+		} else if (!decide->seen_mine[j] && (!decide->probing
+					|| !frontier_enumerate_forced(frontier, component, i, 1, &budget,
+						frontier_decide_solution, decide))) {
+			verdicts[j] = FRONTIER_CLEAR;
+			ret++;
+		}
+	}
+
+	/* The search takes one node more than it had when it runs out */
+	if (budget < 0)
+		budget = 0;
+
+	decide->spent += (decide->probing ? FRONTIER_PROBE_BUDGET : FRONTIER_DECIDE_BUDGET) - budget;
+
+	return ret;
+}
+
+static void frontier_decide_skip(const struct frontier_component *component,
+		unsigned char *verdicts)
+{
+	memset(verdicts + component->first_cell, FRONTIER_EITHER, component->n_cells);
+}
+
+static int frontier_decide_solution(
+		const struct frontier *frontier,
+		const struct frontier_component *component,
+		const unsigned char *mines,
+		int n_mines,
+		void *ctx)
+{
+	struct frontier_decide_s *decide = ctx;
+	unsigned char *seen;
+	int i;
+
+	(void)frontier;
+	(void)n_mines;
+
+	decide->viable = 1;
+
+	for (i = 0; i < component->n_cells; i++) {
+		seen = mines[i] ? decide->seen_mine : decide->seen_clear;
+
+		if (seen[component->first_cell + i])
+			continue;
+
+		seen[component->first_cell + i] = 1;
+
+		if (decide->seen_mine[component->first_cell + i]
+				&& decide->seen_clear[component->first_cell + i])
+			decide->undecided--;
+	}
+
+	/* Every cell has been both a mine and clear. Nothing left to learn. */
+	return decide->probing || decide->undecided == 0;
+}
+
+/* Fills verdicts like frontier_decide() does, but from what row reducing the
+ * numbers of every component as a system of linear equations over its cells
+ * shows, rather than from enumerating layouts. Much cheaper on large
+ * components, though it does not see everything enumeration would. Only
+ * components too large to enumerate quickly are looked at. Returns the number
+ * of decided cells.
+ * */
+int frontier_reduce(const struct frontier *frontier, unsigned char *verdicts)
+{
+	const struct frontier_component *component;
+	int ret = 0;
+	int i;
+
+	memset(verdicts, FRONTIER_EITHER, frontier->n_cells);
+
+	for (i = 0; i < frontier->n_components; i++) {
+		component = &frontier->components[i];
+
+		if (component->n_cells >= FRONTIER_REDUCE_MIN_CELLS
+				&& component->n_cells <= FRONTIER_REDUCE_MAX_CELLS)
+			ret += frontier_reduce_component(frontier, component, verdicts);
+	}
+
+	return ret;
+}
+
+static int frontier_reduce_component(const struct frontier *frontier,
+		const struct frontier_component *component, unsigned char *verdicts)
+{
+	const struct frontier_constraint *constraint;
+	int n_rows = component->n_constraints;
+	int n_cols = component->n_cells;
+	signed char *known;
+	int64_t *matrix;
+	int64_t **rows;
+	int64_t *rhs;
+	int *lo;
+	int *hi;
+	int ret = 0;
+	int col;
+	int i;
+	int j;
+
+	matrix = calloc((size_t)n_rows * n_cols, sizeof(matrix[0]));
+	rows = malloc(n_rows * sizeof(rows[0]));
+	rhs = malloc(n_rows * sizeof(rhs[0]));
+	lo = malloc(n_rows * sizeof(lo[0]));
+	hi = malloc(n_rows * sizeof(hi[0]));
+	known = malloc(n_cols * sizeof(known[0]));
+
+	if (!matrix || !rows || !rhs || !lo || !hi || !known)
+		goto end;
+
+	/* Breadth first numbering keeps the cells of a number close together,
+	 * and so the matrix banded. Rows only ever get touched within lo..hi.
+	 * */
+	for (i = 0; i < n_rows; i++) {
+		constraint = &frontier->constraints[component->first_constraint + i];
+		rows[i] = matrix + (size_t)i * n_cols;
+		rhs[i] = constraint->mines;
+		lo[i] = n_cols;
+		hi[i] = -1;
+
+		for (j = 0; j < constraint->n_cells; j++) {
+			col = constraint->cells[j] - component->first_cell;
+			rows[i][col] = 1;
+
+			if (col < lo[i]) lo[i] = col;
+			if (col > hi[i]) hi[i] = col;
+		}
+	}
+
+	for (j = 0; j < n_cols; j++)
+		known[j] = -1;
+
+	if (frontier_eliminate(rows, rhs, lo, hi, n_rows, n_cols))
+		goto end;
+
+	if (frontier_bound(rows, rhs, lo, hi, n_rows, known))
+		goto end;
+
+	for (j = 0; j < n_cols; j++) {
+		if (known[j] < 0)
+			continue;
+
+		verdicts[component->first_cell + j] = known[j] ? FRONTIER_MINE : FRONTIER_CLEAR;
+		ret++;
+	}
+
+end:
+	free(matrix);
+	free(rows);
+	free(rhs);
+	free(lo);
+	free(hi);
+	free(known);
+
+	return ret;
+}
+
+/* Gauss-Jordan elimination without fractions: a row gets the pivot row
+ * subtracted after both are scaled to the same coefficient, then divided by
+ * the greatest common divisor of what is left. Returns non-zero if
+ * coefficients grow out of hand.
+ * */
+static int frontier_eliminate(int64_t **rows, int64_t *rhs, int *lo, int *hi, int n_rows, int n_cols)
+{
+	int64_t *swap_row;
+	int64_t swap_rhs;
+	int64_t a;
+	int64_t b;
+	int64_t g;
+	int swap_lo;
+	int swap_hi;
+	int rank = 0;
+	int pivot;
+	int col;
+	int r;
+	int j;
+
+	for (col = 0; col < n_cols && rank < n_rows; col++) {
+		pivot = -1;
+
+		/* Of the candidates, the one ending soonest fills in least */
+		for (r = rank; r < n_rows; r++)
+			if (lo[r] <= col && col <= hi[r] && rows[r][col]
+					&& (pivot < 0 || hi[r] < hi[pivot]))
+				pivot = r;
+
+		if (pivot < 0)
+			continue;
+
+		swap_row = rows[pivot]; rows[pivot] = rows[rank]; rows[rank] = swap_row;
+		swap_rhs = rhs[pivot]; rhs[pivot] = rhs[rank]; rhs[rank] = swap_rhs;
+		swap_lo = lo[pivot]; lo[pivot] = lo[rank]; lo[rank] = swap_lo;
+		swap_hi = hi[pivot]; hi[pivot] = hi[rank]; hi[rank] = swap_hi;
+
+		for (r = 0; r < n_rows; r++) {
+			if (r == rank || col < lo[r] || col > hi[r] || !rows[r][col])
+				continue;
+
+			a = rows[rank][col];
+			b = rows[r][col];
+
+			if (lo[rank] < lo[r]) lo[r] = lo[rank];
+			if (hi[rank] > hi[r]) hi[r] = hi[rank];
+
+			for (j = lo[r]; j <= hi[r]; j++)
+				if (frontier_cross(rows[r][j], a, rows[rank][j], b, &rows[r][j]))
+					return 1;
+
+			if (frontier_cross(rhs[r], a, rhs[rank], b, &rhs[r]))
+				return 1;
+
+			/* Coefficients only grow when the pivot is not a unit */
+			g = a == 1 || a == -1 ? 1 : gcd64(0, rhs[r]);
+
+			for (j = lo[r]; j <= hi[r] && g != 1; j++)
+				g = gcd64(g, rows[r][j]);
+
+			if (g > 1) {
+				for (j = lo[r]; j <= hi[r]; j++)
+					rows[r][j] /= g;
+
+				rhs[r] /= g;
+			}
+
+			while (lo[r] <= hi[r] && !rows[r][lo[r]])
+				lo[r]++;
+
+			while (hi[r] >= lo[r] && !rows[r][hi[r]])
+				hi[r]--;
+
+			if (rhs[r] > FRONTIER_REDUCE_MAX_COEF || rhs[r] < -FRONTIER_REDUCE_MAX_COEF)
+				return 1;
+
+			for (j = lo[r]; j <= hi[r]; j++)
+				if (rows[r][j] > FRONTIER_REDUCE_MAX_COEF || rows[r][j] < -FRONTIER_REDUCE_MAX_COEF)
+					return 1;
+		}
+
+		rank++;
+	}
+
+	return 0;
+}
+
+/* Every cell is 0 or 1, so a row can add up to anything between the sum of
+ * its negative and the sum of its positive coefficients. A row that has to
+ * reach either end forces all of its cells. Known cells are folded into the
+ * rows until nothing more comes of it. Returns non-zero if some row cannot
+ * be satisfied at all, in which case the board is broken and nothing is
+ * decided.
+ * */
+static int frontier_bound(int64_t **rows, const int64_t *rhs, const int *lo, const int *hi,
+		int n_rows, signed char *known)
+{
+	int64_t target;
+	int64_t min;
+	int64_t max;
+	int changed = 1;
+	int r;
+	int j;
+
+	while (changed) {
+		changed = 0;
+
+		for (r = 0; r < n_rows; r++) {
+			target = rhs[r];
+			min = 0;
+			max = 0;
+
+			for (j = lo[r]; j <= hi[r]; j++) {
+				if (known[j] >= 0)
+					target -= rows[r][j] * known[j];
+				else if (rows[r][j] > 0)
+					max += rows[r][j];
+				else
+					min += rows[r][j];
+			}
+
+			if (target < min || target > max)
+				return 1;
+
+			if (min == max || (target != min && target != max))
+				continue;
+
+			for (j = lo[r]; j <= hi[r]; j++) {
+				if (known[j] >= 0 || !rows[r][j])
+					continue;
+
+				known[j] = (rows[r][j] > 0) == (target == max);
+				changed = 1;
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* ret = x * a - y * b, non-zero if that does not fit 64 bits */
+static int frontier_cross(int64_t x, int64_t a, int64_t y, int64_t b, int64_t *ret)
+{
+	int64_t xa;
+	int64_t yb;
+#if defined(__GNUC__)
+	if (__builtin_mul_overflow(x, a, &xa) || __builtin_mul_overflow(y, b, &yb))
+		return 1;
+
+	return __builtin_sub_overflow(xa, yb, ret);
+#else
+	uint64_t mx = x < 0 ? 0 - (uint64_t)x : (uint64_t)x;
+	uint64_t ma = a < 0 ? 0 - (uint64_t)a : (uint64_t)a;
+	uint64_t my = y < 0 ? 0 - (uint64_t)y : (uint64_t)y;
+	uint64_t mb = b < 0 ? 0 - (uint64_t)b : (uint64_t)b;
+
+	if ((ma && mx > INT64_MAX / ma) || (mb && my > INT64_MAX / mb))
+		return 1;
+
+	xa = x * a;
+	yb = y * b;
+
+	if (yb > 0 ? xa < INT64_MIN + yb : xa > INT64_MAX + yb)
+		return 1;
+
+	*ret = xa - yb;
+
+	return 0;
+#endif
+}
+
+static int64_t gcd64(int64_t a, int64_t b)
+{
+	int64_t t;
+
+	if (a < 0) a = -a;
+	if (b < 0) b = -b;
+
+	while (b) {
+		t = a % b;
+		a = b;
+		b = t;
+	}
+
+	return a;
+}
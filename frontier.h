@@ -0,0 +1,74 @@
+#ifndef MINESWEEPER_SOLVER_FRONTIER_H
+#define MINESWEEPER_SOLVER_FRONTIER_H
+
+#include "board.h"
+
+#define FRONTIER_EITHER	0
+#define FRONTIER_MINE	1
+#define FRONTIER_CLEAR	2
+
+/* Unknown tile that borders at least one numbered tile. */
+struct frontier_cell {
+	int row;
+	int col;
+	int n_constraints;
+	int constraints[8];	/* Indices into frontier->constraints */
+};
+
+/* Numbered tile that borders at least one unknown tile. */
+struct frontier_constraint {
+	int row;
+	int col;
+	int mines;		/* Mines still missing around this tile */
+	int n_cells;
+	int cells[8];		/* Indices into frontier->cells */
+};
+
+/* A set of cells and constraints that shares no constraint with the rest of
+ * the frontier. Cells and constraints of a component are stored contiguously
+ * so a component is just a pair of ranges.
+ * */
+struct frontier_component {
+	int first_cell;
+	int n_cells;
+	int first_constraint;
+	int n_constraints;
+};
+
+struct frontier {
+	struct frontier_cell *cells;
+	struct frontier_constraint *constraints;
+	struct frontier_component *components;
+	int n_cells;
+	int n_constraints;
+	int n_components;
+	int n_interior;		/* Unknown tiles not bordering any number */
+	int n_known_mines;
+};
+
+/* Called for every mine layout of a component that satisfies all of its
+ * constraints. mines[i] is 1 if cell component->first_cell + i holds a mine.
+ * Returning non-zero stops the enumeration.
+ * */
+typedef int (*frontier_solution_fn)(
+		const struct frontier *frontier,
+		const struct frontier_component *component,
+		const unsigned char *mines,
+		int n_mines,
+		void *ctx);
+
+int frontier_build(struct frontier *frontier, const struct minesweeper_board *board);
+void frontier_destroy(struct frontier *frontier);
+
+int frontier_enumerate(
+		const struct frontier *frontier,
+		const struct frontier_component *component,
+		long *budget,
+		frontier_solution_fn fn,
+		void *ctx);
+
+int frontier_decide(const struct frontier *frontier, unsigned char *verdicts);
+int frontier_decide_jobs(const struct frontier *frontier, unsigned char *verdicts, int jobs);
+int frontier_reduce(const struct frontier *frontier, unsigned char *verdicts);
+
+#endif /* MINESWEEPER_SOLVER_FRONTIER_H */
@@ -0,0 +1,413 @@
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "gen.h"
+#include "mss.h"
+
+/* Fresh boards tried before giving up, how often each may be played through
+ * and repaired and how many repairs one play may take before it is dropped
+ * */
+#define GEN_NO_GUESS_ATTEMPTS	64
+#define GEN_NO_GUESS_ROUNDS	16
+#define GEN_NO_GUESS_REPAIRS(__board)	(8 + (__board)->rows * (__board)->cols / 64)
+
+/* A no-guess board in the making. Every tile remembers when it got clicked or
+ * flagged, so that after a repair only the clicks that came after the first
+ * number it changed have to be played again.
+ * */
+struct gen_play_s {
+	struct minesweeper_board *full;
+	int safe_row;
+	int safe_col;
+	int *order;		/* 0 for the opening, -1 if not clicked yet */
+	int clicks;
+	int earliest;		/* Lowest order of a tile whose number got changed */
+	struct mss_delta *todo;
+};
+
+static int gen_rewind(struct gen_play_s *play);
+static int gen_play(struct gen_play_s *play, struct rng *rng);
+static int gen_repair(struct gen_play_s *play, struct mss_solver *solver, struct rng *rng);
+static int gen_renumber(struct gen_play_s *play, struct mss_solver *solver, int row, int col);
+
+/* Places mines uniformly at random on a fresh full board, i.e. one made of
+ * TILE_MINE and TILE_CLEAR tiles only, the way board_read() would return it.
+ * The 3x3 area around safe_row, safe_col is kept clear so that clicking there
+ * opens up some space, unless the board is too crowded for that, in which
+ * case only the tile itself is kept clear.
+ * */
+int board_generate(struct minesweeper_board *board,
+		int rows, int cols, int mines,
+		int safe_row, int safe_col,
+		struct rng *rng)
+{
+	int *candidates;
+	int n_candidates = 0;
+	int keep_out;
+	int tmp;
+	int i;
+	int j;
+	int k;
+
+	if (rows <= 0 || cols <= 0 || mines < 0 || mines >= rows * cols)
+		return 1;
+
+	candidates = malloc(sizeof(candidates[0]) * rows * cols);
+
+	if (!candidates)
+		return 1;
+
+	board_init(board, rows, cols);
+	keep_out = mines <= rows * cols - 9 ? 1 : 0;
+
+	for (i = 0; i < rows; i++) {
+		for (j = 0; j < cols; j++) {
+			BOARD_AT(board, i, j) = TILE_CLEAR;
+
+			if (abs(i - safe_row) <= keep_out && abs(j - safe_col) <= keep_out)
+				continue;
+
+			candidates[n_candidates++] = i * cols + j;
+		}
+	}
+
+	if (mines > n_candidates)
+		mines = n_candidates;
+
+	/* Partial Fisher-Yates shuffle */
+	for (k = 0; k < mines; k++) {
+		i = k + rng_below(rng, n_candidates - k);
+		tmp = candidates[k];
+		candidates[k] = candidates[i];
+		candidates[i] = tmp;
+
+		BOARD_AT(board, candidates[k] / cols, candidates[k] % cols) = TILE_MINE;
+	}
+
+	free(candidates);
+
+	return 0;
+}
+
+/* Like board_generate(), but the board can be solved from safe_row, safe_col
+ * without guessing, as far as mss.h can tell. Whenever the solver gets stuck,
+ * a mine next to what is revealed is moved to where nothing is known yet and
+ * the numbers around both spots are corrected. Clicks made before any of
+ * those numbers showed up did not depend on them, everything after has to be
+ * checked again, so the next play picks up from there. The board is done once
+ * a play gets to the end without repairs. Returns non-zero if no such board
+ * turned up.
+ * */
+int board_generate_no_guess(struct minesweeper_board *board,
+		int rows, int cols, int mines,
+		int safe_row, int safe_col,
+		struct rng *rng)
+{
+	struct gen_play_s play;
+	int repairs = -1;
+	int attempt;
+	int round;
+
+	if (rows <= 0 || cols <= 0 || safe_row < 0 || safe_row >= rows
+			|| safe_col < 0 || safe_col >= cols)
+		return 1;
+
+	play.full = board;
+	play.safe_row = safe_row;
+	play.safe_col = safe_col;
+	play.order = malloc(sizeof(play.order[0]) * rows * cols);
+	play.todo = malloc(sizeof(play.todo[0]) * rows * cols);
+
+	if (!play.order || !play.todo)
+		goto end;
+
+	for (attempt = 0; attempt < GEN_NO_GUESS_ATTEMPTS; attempt++) {
+		if (board_generate(board, rows, cols, mines, safe_row, safe_col, rng))
+			break;
+
+		play.earliest = 0;
+
+		for (round = 0; round < GEN_NO_GUESS_ROUNDS; round++) {
+			if (gen_rewind(&play)) {
+				board_destroy(board);
+				repairs = -1;
+				goto end;
+			}
+
+			if ((repairs = gen_play(&play, rng)) <= 0)
+				break;
+		}
+
+		if (!repairs)
+			break;
+
+		board_destroy(board);
+	}
+
+end:
+	free(play.order);
+	free(play.todo);
+
+	return repairs != 0;
+}
+
+/* Turns a full board into the partial board a player would see right after
+ * clicking row, col: the opening is revealed with its numbers and everything
+ * else is unknown. Returns non-zero if memory runs out; partial has to be
+ * destroyed either way.
+ * */
+int board_generate_opening(struct minesweeper_board *partial,
+		const struct minesweeper_board *full,
+		int row, int col)
+{
+	int *stack;
+	int top = 0;
+	int r;
+	int c;
+	int i;
+	int j;
+	int n;
+
+	board_init(partial, full->rows, full->cols);
+
+	if (BOARD_AT(full, row, col) & TILE_MINE)
+		return 0;
+
+	stack = malloc(sizeof(stack[0]) * full->rows * full->cols);
+
+	if (!stack)
+		return 1;
+
+	stack[top++] = row * full->cols + col;
+	BOARD_AT(partial, row, col) = board_count_neighbor_mines(full, row, col);
+
+	while (top) {
+		r = stack[--top] / full->cols;
+		c = stack[top] % full->cols;
+
+		if (BOARD_AT(partial, r, c) != 0)
+			continue;
+
+		for (i = -1; i <= 1; i++) {
+			for (j = -1; j <= 1; j++) {
+				if (BOARD_AT(partial, r + i, c + j) != TILE_UNKNOWN)
+					continue;
+
+				n = board_count_neighbor_mines(full, r + i, c + j);
+				BOARD_AT(partial, r + i, c + j) = n;
+
+				if (!n)
+					stack[top++] = (r + i) * full->cols + c + j;
+			}
+		}
+	}
+
+	free(stack);
+
+	return 0;
+}
+
+/* Forgets every click from play->earliest on. Going all the way back means
+ * starting over from the opening, which may have changed shape. Returns
+ * non-zero if memory runs out.
+ * */
+static int gen_rewind(struct gen_play_s *play)
+{
+	struct minesweeper_board opening;
+	int tiles = play->full->rows * play->full->cols;
+	int i;
+
+	if (play->earliest > 0) {
+		for (i = 0; i < tiles; i++)
+			if (play->order[i] >= play->earliest)
+				play->order[i] = -1;
+
+		play->clicks = play->earliest;
+		play->earliest = INT_MAX;
+		return 0;
+	}
+
+	if (board_generate_opening(&opening, play->full, play->safe_row, play->safe_col)) {
+		board_destroy(&opening);
+		return 1;
+	}
+
+	for (i = 0; i < tiles; i++)
+		play->order[i] = BOARD_AT(&opening, i / opening.cols, i % opening.cols) <= 8 ? 0 : -1;
+
+	board_destroy(&opening);
+	play->clicks = 1;
+	play->earliest = INT_MAX;
+
+	return 0;
+}
+
+/* Plays the board out from the clicks play->order remembers, clicking and
+ * flagging whatever the solver deduces and repairing the board whenever it
+ * gets stuck. Returns how many repairs it took or -1 if the board can not be
+ * repaired.
+ * */
+static int gen_play(struct gen_play_s *play, struct rng *rng)
+{
+	struct minesweeper_board *full = play->full;
+	struct minesweeper_board partial;
+	struct mss_solver *solver = NULL;
+	const struct mss_delta *deltas;
+	struct mss_delta delta;
+	int ret = -1;
+	int repairs = 0;
+	int to_reveal = 0;
+	int n_todo = 0;
+	int n;
+	int i;
+	int j;
+
+	board_init(&partial, full->rows, full->cols);
+
+	for (i = 0; i < full->rows; i++) {
+		for (j = 0; j < full->cols; j++) {
+			if (play->order[i * full->cols + j] < 0) {
+				if (!(BOARD_AT(full, i, j) & TILE_MINE))
+					to_reveal++;
+			} else if (BOARD_AT(full, i, j) & TILE_MINE) {
+				BOARD_AT(&partial, i, j) = TILE_MINE;
+			} else {
+				BOARD_AT(&partial, i, j) = board_count_neighbor_mines(full, i, j);
+			}
+		}
+	}
+
+	solver = mss_solver_create(&partial, MSS_SOLVER_DEFAULT);
+
+	if (!solver)
+		goto end;
+
+	n = mss_solver_deduce(solver, &deltas);
+
+	for (;;) {
+		if (n == MSS_ERROR)
+			goto end;
+
+		for (i = 0; i < n; i++)
+			play->todo[n_todo++] = deltas[i];
+
+		if (!to_reveal) {
+			ret = repairs;
+			goto end;
+		}
+
+		if (!n_todo) {
+			/* Mines moved along the frontier can go round in circles */
+			if (repairs >= GEN_NO_GUESS_REPAIRS(full) || gen_repair(play, solver, rng))
+				goto end;
+
+			repairs++;
+			n = mss_solver_deduce(solver, &deltas);
+			continue;
+		}
+
+		delta = play->todo[--n_todo];
+		play->order[delta.row * full->cols + delta.col] = play->clicks++;
+
+		if (delta.mine) {
+			n = mss_solver_flag(solver, delta.row, delta.col, &deltas);
+		} else {
+			n = mss_solver_reveal(solver, delta.row, delta.col,
+					board_count_neighbor_mines(full, delta.row, delta.col), &deltas);
+			to_reveal--;
+		}
+	}
+
+end:
+	mss_solver_destroy(solver);
+	board_destroy(&partial);
+
+	return ret;
+}
+
+/* Moves a random mine bordering what is revealed to a random tile nothing
+ * is known about, preferably one that borders nothing revealed either, so
+ * that fewer numbers change. Everything known or deduced stays as it was.
+ * Returns non-zero if there is no such mine or no room for it.
+ * */
+static int gen_repair(struct gen_play_s *play, struct mss_solver *solver, struct rng *rng)
+{
+	const struct minesweeper_board *board = mss_solver_board(solver);
+	struct minesweeper_board *full = play->full;
+	unsigned char *tile;
+	int n_from = 0;
+	int n_to = 0;
+	int from_row = -1;
+	int from_col = -1;
+	int to_row = -1;
+	int to_col = -1;
+	int to_border = 1;
+	int border;
+	int i;
+	int j;
+	int k;
+	int l;
+
+	for (i = 0; i < board->rows; i++) {
+		for (j = 0; j < board->cols; j++) {
+			if (!TILE_IS_OPEN(BOARD_AT(board, i, j)))
+				continue;
+
+			border = 0;
+
+			BOARD_FOREACH_NEIGHBOR(board, i, j, k, l, tile)
+				if (*tile <= 8)
+					border = 1;
+
+			/* Reservoir sampling keeps every candidate equally likely */
+			if (BOARD_AT(full, i, j) & TILE_MINE) {
+				if (border && !rng_below(rng, ++n_from)) {
+					from_row = i;
+					from_col = j;
+				}
+
+				continue;
+			}
+
+			if (border > to_border)
+				continue;
+
+			if (border < to_border) {
+				to_border = border;
+				n_to = 0;
+			}
+
+			if (!rng_below(rng, ++n_to)) {
+				to_row = i;
+				to_col = j;
+			}
+		}
+	}
+
+	if (!n_from || !n_to)
+		return 1;
+
+	BOARD_AT(full, from_row, from_col) = TILE_CLEAR;
+	BOARD_AT(full, to_row, to_col) = TILE_MINE;
+
+	BOARD_FOREACH_NEIGHBOR(board, from_row, from_col, k, l, tile)
+		if (*tile <= 8 && gen_renumber(play, solver, from_row + k, from_col + l))
+			return 1;
+
+	BOARD_FOREACH_NEIGHBOR(board, to_row, to_col, k, l, tile)
+		if (*tile <= 8 && gen_renumber(play, solver, to_row + k, to_col + l))
+			return 1;
+
+	return 0;
+}
+
+static int gen_renumber(struct gen_play_s *play, struct mss_solver *solver, int row, int col)
+{
+	int order = play->order[row * play->full->cols + col];
+
+	if (order < play->earliest)
+		play->earliest = order;
+
+	return mss_solver_renumber(solver, row, col, board_count_neighbor_mines(play->full, row, col));
+}
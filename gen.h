@@ -0,0 +1,21 @@
+#ifndef MINESWEEPER_SOLVER_GEN_H
+#define MINESWEEPER_SOLVER_GEN_H
+
+#include "board.h"
+#include "rng.h"
+
+int board_generate(struct minesweeper_board *board,
+		int rows, int cols, int mines,
+		int safe_row, int safe_col,
+		struct rng *rng);
+
+int board_generate_no_guess(struct minesweeper_board *board,
+		int rows, int cols, int mines,
+		int safe_row, int safe_col,
+		struct rng *rng);
+
+int board_generate_opening(struct minesweeper_board *partial,
+		const struct minesweeper_board *full,
+		int row, int col);
+
+#endif /* MINESWEEPER_SOLVER_GEN_H */
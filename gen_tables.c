@@ -0,0 +1,234 @@
+/* Generates lookup tables used by board.c at build time.
+ *
+ * layout_counts[mines] holds, for a 3x3 window with mines in the positions
+ * given by the 9-bit mask, how many of those mines each tile of the window
+ * can see. The nine counts are packed into LAYOUT_FIELD_BITS wide fields with
+ * the top bit of every field left clear as a guard, so that all nine can be
+ * range checked with two subtractions.
+ *
+ * tile_strings[color][tile] holds what board_to_string_buf() prints for a tile,
+ * separating space included, without and with ANSI colors.
+ * */
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define LAYOUT_FIELD_BITS 6
+
+/* Must match board.h */
+#define TILE_MINE		(1 << 4)
+#define TILE_UNKNOWN		(1 << 5)
+#define TILE_DEDUCED		(1 << 6)
+#define TILE_BUGGERED		(1 << 7)
+
+/* Room for the longest string plus its terminator, a power of two so that
+ * whole entries can be copied at once
+ * */
+#define TILE_STRING_SIZE 32
+
+#define BOLD "\033[1m"
+#define RESET "\033[0m"
+
+/* Patterns that mask out mine bits irrelevant to calculating the neighbor
+ * mine count of a particular tile
+ * */
+static const uint16_t mine_count_masks[] = {
+	3 | (3 << 3),
+	7 | (7 << 3),
+	6 | (6 << 3),
+
+	3 | 3 << 3 | 3 << 6,
+	~(~0U << 9),
+	6 | 6 << 3 | 6 << 6,
+
+	3 << 3 | 3 << 6,
+	7 << 3 | 7 << 6,
+	6 << 3 | 6 << 6
+};
+
+/* Colors of the tiles as given, indexed by their count, 9 being a mine */
+static const char *const known_colors[10] = {
+	"40;40;40",
+	"60;255;0",
+	"120;255;0",
+	"180;255;0",
+	"255;255;0",
+	"255;180;0",
+	"255;120;0",
+	"255;60;0",
+	"255;0;0",
+	"255;0;0",
+};
+
+static int bit_count(unsigned n);
+static int write_layout_counts(FILE *out);
+static int write_tile_strings(FILE *out);
+static void tile_string(unsigned tile, int color, char *str);
+
+static int bit_count(unsigned n)
+{
+	int ret = 0;
+
+	for (; n; n &= n - 1)
+		ret++;
+
+	return ret;
+}
+
+int main(int argc, char **argv)
+{
+	FILE *out;
+	int i;
+
+	if (argc != 3) {
+		fprintf(stderr, "Usage: %s <layout count header> <tile string header>\n", argv[0]);
+		return 1;
+	}
+
+	for (i = 1; i < 3; i++) {
+		out = fopen(argv[i], "w");
+
+		if (!out) {
+			perror(argv[i]);
+			return 1;
+		}
+
+		if (i == 1 ? write_layout_counts(out) : write_tile_strings(out)) {
+			fclose(out);
+			return 1;
+		}
+
+		if (fclose(out))
+			return 1;
+	}
+
+	return 0;
+}
+
+static int write_layout_counts(FILE *out)
+{
+	uint64_t guards = 0;
+	uint64_t packed;
+	unsigned mines;
+	int i;
+
+	for (i = 0; i < 9; i++)
+		guards |= (uint64_t)1 << (i * LAYOUT_FIELD_BITS + LAYOUT_FIELD_BITS - 1);
+
+	fputs("/* Generated by gen_tables.c. Do not edit. */\n", out);
+	fputs("#ifndef MINESWEEPER_SOLVER_LAYOUT_COUNTS_H\n", out);
+	fputs("#define MINESWEEPER_SOLVER_LAYOUT_COUNTS_H\n\n", out);
+	fputs("#include <stdint.h>\n\n", out);
+	fprintf(out, "#define LAYOUT_FIELD_BITS\t%i\n", LAYOUT_FIELD_BITS);
+	fprintf(out, "#define LAYOUT_FIELD_MAX\t%i\n", (1 << (LAYOUT_FIELD_BITS - 1)) - 1);
+	fprintf(out, "#define LAYOUT_GUARDS\t\t0x%llxULL\n\n", (unsigned long long)guards);
+	fputs("static const uint64_t layout_counts[512] = {\n", out);
+
+	for (mines = 0; mines < 512; mines++) {
+		packed = 0;
+
+		for (i = 0; i < 9; i++)
+			packed |= (uint64_t)bit_count(mines & mine_count_masks[i])
+				<< (i * LAYOUT_FIELD_BITS);
+
+		fprintf(out, "\t0x%llxULL,\n", (unsigned long long)packed);
+	}
+
+	fputs("};\n\n", out);
+	fputs("#endif /* MINESWEEPER_SOLVER_LAYOUT_COUNTS_H */\n", out);
+
+	return ferror(out);
+}
+
+static int write_tile_strings(FILE *out)
+{
+	char str[TILE_STRING_SIZE];
+	unsigned tile;
+	int color;
+	int i;
+
+	fputs("/* Generated by gen_tables.c. Do not edit. */\n", out);
+	fputs("#ifndef MINESWEEPER_SOLVER_TILE_STRINGS_H\n", out);
+	fputs("#define MINESWEEPER_SOLVER_TILE_STRINGS_H\n\n", out);
+	fprintf(out, "#define TILE_STRING_SIZE\t%i\n\n", TILE_STRING_SIZE);
+	fputs("/* 0 for tiles that cannot be printed */\n", out);
+	fputs("static const unsigned char tile_string_lengths[2][256] = {\n", out);
+
+	for (color = 0; color < 2; color++) {
+		fputs("\t{", out);
+
+		for (tile = 0; tile < 256; tile++) {
+			tile_string(tile, color, str);
+			fprintf(out, "%s%i,", tile % 16 ? " " : "\n\t\t", (int)strlen(str));
+		}
+
+		fputs("\n\t},\n", out);
+	}
+
+	fputs("};\n\n", out);
+	fputs("static const char tile_strings[2][256][TILE_STRING_SIZE] = {\n", out);
+
+	for (color = 0; color < 2; color++) {
+		fputs("\t{\n", out);
+
+		for (tile = 0; tile < 256; tile++) {
+			tile_string(tile, color, str);
+			fputs("\t\t\"", out);
+
+			/* Octal escapes stop after three digits, so digits that
+			 * follow one are safe
+			 * */
+			for (i = 0; str[i]; i++) {
+				if (str[i] == '\033')
+					fputs("\\033", out);
+				else
+					fputc(str[i], out);
+			}
+
+			fputs("\",\n", out);
+		}
+
+		fputs("\t},\n", out);
+	}
+
+	fputs("};\n\n", out);
+	fputs("#endif /* MINESWEEPER_SOLVER_TILE_STRINGS_H */\n", out);
+
+	return ferror(out);
+}
+
+/* Empty for tiles that cannot be printed */
+static void tile_string(unsigned tile, int color, char *str)
+{
+	static const char symbols[] = ".12345678#";
+	unsigned count = tile & ~(TILE_UNKNOWN | TILE_DEDUCED | TILE_BUGGERED);
+	char symbol;
+	int n;
+
+	*str = 0;
+
+	if (count <= 8)
+		n = count;
+	else if (count == TILE_MINE)
+		n = 9;
+	else if ((tile & (TILE_UNKNOWN | TILE_DEDUCED | TILE_BUGGERED)) == TILE_UNKNOWN)
+		n = 0;
+	else
+		return;
+
+	symbol = symbols[n];
+
+	if ((tile & (TILE_UNKNOWN | TILE_DEDUCED | TILE_BUGGERED)) == TILE_UNKNOWN)
+		symbol = '?';
+
+	if (!color)
+		sprintf(str, "%c ", symbol);
+	else if (tile & TILE_BUGGERED)
+		sprintf(str, BOLD "\033[38;2;255;0;0m%c" RESET RESET " ", symbol);
+	else if (tile & TILE_DEDUCED)
+		sprintf(str, "\033[38;2;255;255;0m%c" RESET " ", symbol);
+	else if (tile & TILE_UNKNOWN)
+		sprintf(str, "\033[38;2;0;0;255m%c" RESET " ", symbol);
+	else
+		sprintf(str, "\033[38;2;%sm%c" RESET " ", known_colors[n], symbol);
+}
@@ -3,70 +3,329 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
 
+#include "batch.h"
 #include "board.h"
+#include "buf.h"
+#include "cache.h"
+#include "gen.h"
+#include "rng.h"
+#include "server.h"
+#include "sim.h"
+#include "stats.h"
 
 static int parse_i(const char *str, int base, int *ret);
+static int simulate(const struct sim_options *options);
+static int generate(const struct sim_options *options, int count, struct gr_buffer *strbuf);
+static void usage(const char *argv0);
 
 int main(const int argc, const char **argv)
 {
 	struct minesweeper_board board = {0};
+	struct deduce_cache cache = {0};
+	struct batch_options options = {0};
+	struct board_pipeline pipeline;
+	struct board_stats stats = {0};
+	struct sim_options sim = {0};
+	const char *size = "expert";
+	const char *serve = NULL;	/* Socket path, "-" for standard input */
+	uint64_t start;
 	struct gr_buffer strbuf;
+	const char *positional[2];
+	int n_positional = 0;
+	int batch = 0;
+	int simulating = 0;
+	int generating = 0;	/* Boards to generate */
+	int convert = 0;	/* 'b' to binary, 't' to text */
+	int games = 10000;
+	char *endptr;
+	int color = -1;		/* Only when writing to a terminal */
+	int print_stats = 0;
 	int ret = 0;
-	int row = 0;
-	int col = 0;
+	int i;
 
 	gr_buf_init(&strbuf, 64);
+	options.mines = -1;
+	sim.policy = SIM_POLICY_SAFEST;
+	board_pipeline_init(&pipeline);
+
+	for (i = 1; i < argc; i++) {
+		if (!strcmp(argv[i], "--batch")) {
+			batch = 1;
+		} else if (!strcmp(argv[i], "--serve") && i + 1 < argc) {
+			serve = argv[++i];
+		} else if (!strcmp(argv[i], "--simulate")) {
+			simulating = 1;
+		} else if (!strcmp(argv[i], "--generate") && i + 1 < argc) {
+			if (parse_i(argv[++i], 0, &generating) || generating <= 0) {
+				usage(argv[0]);
+				ret = 1;
+				goto end;
+			}
+		} else if (!strcmp(argv[i], "--games") && i + 1 < argc) {
+			if (parse_i(argv[++i], 0, &games) || games <= 0) {
+				usage(argv[0]);
+				ret = 1;
+				goto end;
+			}
+		} else if (!strcmp(argv[i], "--size") && i + 1 < argc) {
+			size = argv[++i];
+		} else if (!strcmp(argv[i], "--seed") && i + 1 < argc) {
+			errno = 0;
+			sim.seed = strtoull(argv[++i], &endptr, 0);
+
+			if (errno || *endptr) {
+				usage(argv[0]);
+				ret = 1;
+				goto end;
+			}
+		} else if (!strcmp(argv[i], "--policy") && i + 1 < argc) {
+			if (sim_policy_parse(argv[++i], &sim.policy)) {
+				usage(argv[0]);
+				ret = 1;
+				goto end;
+			}
+		} else if (!strcmp(argv[i], "--to-binary")) {
+			convert = 'b';
+		} else if (!strcmp(argv[i], "--to-text")) {
+			convert = 't';
+		} else if (!strcmp(argv[i], "--tagged")) {
+			options.tagged = 1;
+		} else if (!strcmp(argv[i], "--length-prefixed")) {
+			options.length_prefixed = 1;
+		} else if (!strcmp(argv[i], "--stats")) {
+			print_stats = 1;
+		} else if (!strcmp(argv[i], "--count")) {
+			options.count = 1;
+		} else if (!strcmp(argv[i], "--probabilities")) {
+			options.probabilities = 1;
+		} else if (!strcmp(argv[i], "--mines") && i + 1 < argc) {
+			if (parse_i(argv[++i], 0, &options.mines) || options.mines < 0) {
+				usage(argv[0]);
+				ret = 1;
+				goto end;
+			}
+		} else if (!strcmp(argv[i], "--color") && i + 1 < argc) {
+			i++;
+
+			if (!strcmp(argv[i], "always")) {
+				color = 1;
+			} else if (!strcmp(argv[i], "never")) {
+				color = 0;
+			} else if (!strcmp(argv[i], "auto")) {
+				color = -1;
+			} else {
+				usage(argv[0]);
+				ret = 1;
+				goto end;
+			}
+		} else if (!strcmp(argv[i], "--stages") && i + 1 < argc) {
+			if (board_pipeline_parse(&pipeline, argv[++i])) {
+				usage(argv[0]);
+				ret = 1;
+				goto end;
+			}
 
-	if (argc == 3) {
-		if (parse_i(argv[1], 0, &row) || parse_i(argv[2], 0, &col)) {
+			options.pipeline = &pipeline;
+		} else if (!strcmp(argv[i], "--jobs") && i + 1 < argc) {
+			if (parse_i(argv[++i], 0, &options.jobs)) {
+				usage(argv[0]);
+				ret = 1;
+				goto end;
+			}
+		} else if (argv[i][0] == '-' && argv[i][1] == '-') {
+			usage(argv[0]);
+			ret = 1;
+			goto end;
+		} else if (n_positional < 2) {
+			positional[n_positional++] = argv[i];
+		} else {
+			usage(argv[0]);
 			ret = 1;
 			goto end;
 		}
-	} else if (argc != 1) {
+	}
+
+	if (n_positional == 2) {
+		if (parse_i(positional[0], 0, &options.row) || parse_i(positional[1], 0, &options.col)) {
+			ret = 1;
+			goto end;
+		}
+	} else if (n_positional != 0) {
+		usage(argv[0]);
 		ret = 1;
 		goto end;
 	}
 
-	board_read(&board, stdin);
+	/* Answers go to clients, not terminals */
+	if (serve && color < 0)
+		color = 0;
 
-	board_to_string_buf(&board, &strbuf);
-	fwrite(strbuf.buf, 1, strbuf.length, stdout);
-
-	if (board_is_full(&board)) {
-		puts("Board is full. Attempting to solve from start.");
-
-		switch (board_solve_full(&board, row, col)) {
-		case BOARD_SOLVE_SUCCESS:
-			puts("Board solved.");
-			break;
-		case BOARD_SOLVE_MUST_GUESS:
-			puts("Board cannot be solved without guessing.");
-			break;
-		default: puts("BUG!");
-			 ret = 1;
-			 goto end;
-		}
-	} else if (board_is_partial(&board)) {
-		puts("A partial solution is given.");
+	board_set_color(color < 0 ? isatty(STDOUT_FILENO) : color);
+
+	if (convert == 'b') {
+		ret = batch_to_binary(stdin, stdout, &options);
+		goto end;
+	} else if (convert == 't') {
+		ret = batch_to_text(stdin, stdout);
+		goto end;
+	}
 
-		if (!board_mine_numbers_consistent(&board)) {
-			puts("Board mine number inconsistent!");
+	if (simulating || generating) {
+		if (sim_size_parse(size, &sim.rows, &sim.cols, &sim.mines)) {
+			usage(argv[0]);
 			ret = 1;
 			goto end;
 		}
 
-		puts("Mine numbers consistent. Attempting to deduce next moves.");
-		board_deduce_partial(&board);
+		if (options.mines >= 0)
+			sim.mines = options.mines;
+
+		sim.row = n_positional ? options.row : sim.rows / 2;
+		sim.col = n_positional ? options.col : sim.cols / 2;
+		sim.games = games;
+		sim.jobs = options.jobs;
+
+		ret = simulating ? simulate(&sim) : generate(&sim, generating, &strbuf);
+		goto end;
+	}
+
+	if (serve) {
+		ret = server_run(serve, &options);
+		goto end;
+	}
+
+	if (batch) {
+		if (print_stats)
+			options.stats = &stats;
+
+		ret = batch_run(stdin, stdout, &options);
+		goto stats;
+	}
+
+	start = board_stats_now_ns();
+	board_read(&board, stdin);
+	board.jobs = options.jobs > 0 ? options.jobs : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	board.pipeline = &pipeline;
+	board.stats = &stats;
+	stats.read_ns = board_stats_now_ns() - start;
+
+	if (!deduce_cache_init(&cache, DEDUCE_CACHE_DEFAULT_SIZE))
+		board.cache = &cache;
+
+	start = board_stats_now_ns();
+	ret = batch_solve_one(&board, &options, &strbuf);
+	stats.solve_ns = board_stats_now_ns() - start;
+
+	start = board_stats_now_ns();
+	buf_write(&strbuf, stdout);
+	stats.write_ns = board_stats_now_ns() - start;
+
+stats:
+	/* Standard output is for boards */
+	if (print_stats) {
+		gr_buf_clear(&strbuf);
+
+		if (board_stats_to_json(&stats, &strbuf))
+			ret = 1;
+		else
+			buf_write(&strbuf, stderr);
 	}
 
 end:
 	gr_buf_delete(&strbuf);
 	board_destroy(&board);
+	deduce_cache_destroy(&cache);
 
 	return ret;
 }
 
+static void usage(const char *argv0)
+{
+	fprintf(stderr, "Usage: %s [--jobs N] [--stages LIST] [--stats] [--color always|never|auto]\n"
+			"           [--count] [--probabilities] [--mines N] [row col]\n", argv0);
+	fprintf(stderr, "       %s --batch [--jobs N] [--stages LIST] [--stats] [--tagged]\n"
+			"           [--length-prefixed] [--color always|never|auto]\n"
+			"           [--count] [--probabilities] [--mines N] [row col]\n", argv0);
+	fprintf(stderr, "       %s --simulate [--games N] [--size NAME|RxC] [--mines N] [--seed N]\n"
+			"           [--policy random|safest|corners] [--jobs N] [row col]\n", argv0);
+	fprintf(stderr, "       %s --generate N [--size NAME|RxC] [--mines N] [--seed N]\n"
+			"           [--color always|never|auto] [row col]\n", argv0);
+	fprintf(stderr, "       %s --serve PATH|- [--stages LIST] [--color always|never|auto]\n", argv0);
+	fprintf(stderr, "       %s --to-binary [--length-prefixed] [--mines N]\n", argv0);
+	fprintf(stderr, "       %s --to-text [--color always|never|auto]\n", argv0);
+	fprintf(stderr, "Stages: simple, pairs, windows, frontier\n");
+	fprintf(stderr, "Sizes: beginner, intermediate, expert or rows x cols, e.g. 30x50\n");
+}
+
+/* Plays the games and prints how many were won, with a 95% confidence
+ * interval. Games the solver got wrong are reported and fail the run.
+ * */
+static int simulate(const struct sim_options *options)
+{
+	struct sim_result result;
+	double low;
+	double high;
+
+	if (sim_run(options, &result)) {
+		fprintf(stderr, "Can not simulate %i mines on %ix%i starting at %i,%i\n",
+				options->mines, options->rows, options->cols,
+				options->row, options->col);
+		return 1;
+	}
+
+	sim_wilson(result.wins, result.games, 1.96, &low, &high);
+
+	printf("Games: %lu (%ix%i, %i mines, policy %s, seed %llu)\n",
+			result.games, options->rows, options->cols, options->mines,
+			sim_policy_names[options->policy], (unsigned long long)options->seed);
+	printf("Wins: %lu (%.2f%%, 95%% CI %.2f%% - %.2f%%)\n",
+			result.wins, result.games ? 100.0 * result.wins / result.games : 0,
+			100 * low, 100 * high);
+	printf("Guesses: %lu, %.2f per game, needed in %lu games\n",
+			result.guesses, result.games ? (double)result.guesses / result.games : 0,
+			result.guessed_games);
+
+	if (result.errors) {
+		printf("Errors: %lu\n", result.errors);
+		return 1;
+	}
+
+	return 0;
+}
+
+/* Writes count boards that can be solved from options->row, options->col
+ * without guessing, the way --batch reads them
+ * */
+static int generate(const struct sim_options *options, int count, struct gr_buffer *strbuf)
+{
+	struct minesweeper_board board;
+	struct rng rng;
+	int i;
+
+	rng_seed(&rng, options->seed);
+
+	for (i = 0; i < count; i++) {
+		if (board_generate_no_guess(&board, options->rows, options->cols,
+					options->mines, options->row, options->col, &rng)) {
+			fprintf(stderr, "Can not generate %i mines on %ix%i without guessing from %i,%i\n",
+					options->mines, options->rows, options->cols,
+					options->row, options->col);
+			return 1;
+		}
+
+		gr_buf_clear(strbuf);
+		board_to_string_buf(&board, strbuf);
+		gr_buf_append_char(strbuf, '\n');
+		buf_write(strbuf, stdout);
+		board_destroy(&board);
+	}
+
+	return 0;
+}
+
 static int parse_i(const char *str, int base, int *ret)
 {
 	long maybe_ret;
@@ -0,0 +1,400 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "cache.h"
+#include "mss.h"
+#include "worklist.h"
+
+struct mss_solver {
+	struct minesweeper_board board;
+	struct board_worklist worklist;
+	struct board_worklist dirty;	/* Tiles changed since the window rule last ran */
+	struct board_worklist windows;	/* Numbers close enough to a dirty tile to care */
+	struct deduce_cache cache;
+	struct board_arena arena;	/* Kept between calls so rules stop allocating */
+	int flags;
+	int fresh;		/* No rule has looked at the board as a whole yet */
+	int outstanding;	/* Deduced tiles not yet revealed or flagged */
+	int n_deltas;
+	struct mss_delta *deltas;
+};
+
+static int mss_solver_collect(struct mss_solver *solver, const struct mss_delta **deltas);
+static void mss_solver_queue_around(struct mss_solver *solver, int row, int col);
+static void mss_solver_queue_windows(struct mss_solver *solver, int row, int col);
+static int mss_solver_run(struct mss_solver *solver, int full);
+
+struct mss_solver *mss_solver_create(const struct minesweeper_board *board, int flags)
+{
+	struct mss_solver *solver;
+	int i;
+	int j;
+
+	solver = calloc(1, sizeof(*solver));
+
+	if (!solver)
+		return NULL;
+
+	board_copy(&solver->board, board);
+	solver->flags = flags;
+	solver->fresh = 1;
+	solver->deltas = malloc((size_t)board->rows * board->cols * sizeof(solver->deltas[0]));
+
+	if (!solver->deltas
+			|| worklist_init(&solver->worklist, board->rows, board->cols)
+			|| worklist_init(&solver->dirty, board->rows, board->cols)
+			|| worklist_init(&solver->windows, board->rows, board->cols)) {
+		worklist_destroy(&solver->worklist);
+		worklist_destroy(&solver->dirty);
+		board_destroy(&solver->board);
+		free(solver->deltas);
+		free(solver);
+		return NULL;
+	}
+
+	/* Not having a cache only makes windows slower */
+	if (!deduce_cache_init(&solver->cache, DEDUCE_CACHE_DEFAULT_SIZE))
+		solver->board.cache = &solver->cache;
+
+	arena_init(&solver->arena);
+	solver->board.arena = &solver->arena;
+	solver->board.worklist = &solver->worklist;
+
+	for (i = 0; i < board->rows; i++)
+		for (j = 0; j < board->cols; j++)
+			if (BOARD_AT(board, i, j) <= 8)
+				worklist_push(&solver->worklist, i, j);
+
+	return solver;
+}
+
+void mss_solver_destroy(struct mss_solver *solver)
+{
+	if (!solver)
+		return;
+
+	worklist_destroy(&solver->worklist);
+	worklist_destroy(&solver->dirty);
+	worklist_destroy(&solver->windows);
+	deduce_cache_destroy(&solver->cache);
+	arena_destroy(&solver->arena);
+	board_destroy(&solver->board);
+	free(solver->deltas);
+	free(solver);
+}
+
+/* Deduced tiles are marked with TILE_DEDUCED until they are revealed or
+ * flagged.
+ * */
+const struct minesweeper_board *mss_solver_board(const struct mss_solver *solver)
+{
+	return &solver->board;
+}
+
+int mss_solver_deduce(struct mss_solver *solver, const struct mss_delta **deltas)
+{
+	if (mss_solver_run(solver, 1))
+		return MSS_ERROR;
+
+	return mss_solver_collect(solver, deltas);
+}
+
+/* The tile at row, col turned out to be clear with number mines around it.
+ * Revealing a tile already deduced to be clear is fine; one known or
+ * deduced to be a mine is a contradiction.
+ * */
+int mss_solver_reveal(struct mss_solver *solver, int row, int col, int number,
+		const struct mss_delta **deltas)
+{
+	struct minesweeper_board *board = &solver->board;
+	unsigned char *tile;
+	unsigned char tile_now;
+	int mines = 0;
+	int unknown = 0;
+	int i;
+	int j;
+
+	if (row < 0 || row >= board->rows || col < 0 || col >= board->cols)
+		return MSS_ERROR;
+
+	if (number < 0 || number > 8)
+		return MSS_ERROR;
+
+	tile_now = BOARD_AT(board, row, col);
+	solver->worklist.n_revealed = 0;
+
+	if (tile_now <= 8)
+		return tile_now == number ? mss_solver_collect(solver, deltas) : MSS_ERROR;
+
+	if (TILE_IS_MINE(tile_now))
+		return MSS_ERROR;
+
+	BOARD_FOREACH_NEIGHBOR(board, row, col, i, j, tile) {
+		if (TILE_IS_KNOWN_MINE(*tile))
+			mines++;
+		else if (TILE_IS_OPEN(*tile))
+			unknown++;
+	}
+
+	if (number < mines || number > mines + unknown)
+		return MSS_ERROR;
+
+	if (tile_now & TILE_DEDUCED)
+		solver->outstanding--;
+
+	BOARD_AT(board, row, col) = number;
+	worklist_push(&solver->worklist, row, col);
+	mss_solver_queue_around(solver, row, col);
+
+	worklist_push(&solver->dirty, row, col);
+
+	if (mss_solver_run(solver, 0))
+		return MSS_ERROR;
+
+	return mss_solver_collect(solver, deltas);
+}
+
+/* The tile at row, col is known to be a mine. */
+int mss_solver_flag(struct mss_solver *solver, int row, int col,
+		const struct mss_delta **deltas)
+{
+	struct minesweeper_board *board = &solver->board;
+	unsigned char *tile;
+	unsigned char tile_now;
+	int i;
+	int j;
+	int k;
+	int l;
+	int mines;
+	unsigned char *around;
+
+	if (row < 0 || row >= board->rows || col < 0 || col >= board->cols)
+		return MSS_ERROR;
+
+	tile_now = BOARD_AT(board, row, col);
+	solver->worklist.n_revealed = 0;
+
+	if (TILE_IS_MINE(tile_now)) {
+		if (tile_now & TILE_DEDUCED)
+			solver->outstanding--;
+
+		BOARD_AT(board, row, col) = TILE_MINE;
+
+		/* The costlier rules may have been waiting on this one */
+		if (mss_solver_run(solver, 0))
+			return MSS_ERROR;
+
+		return mss_solver_collect(solver, deltas);
+	}
+
+	if (!TILE_IS_OPEN(tile_now))
+		return MSS_ERROR;
+
+	/* No number around may end up with more mines than it says */
+	BOARD_FOREACH_NEIGHBOR(board, row, col, i, j, tile) {
+		if (*tile > 8)
+			continue;
+
+		mines = 0;
+
+		BOARD_FOREACH_NEIGHBOR(board, row + i, col + j, k, l, around)
+			if (TILE_IS_KNOWN_MINE(*around))
+				mines++;
+
+		if (mines + 1 > *tile)
+			return MSS_ERROR;
+	}
+
+	BOARD_AT(board, row, col) = TILE_MINE;
+	mss_solver_queue_around(solver, row, col);
+
+	worklist_push(&solver->dirty, row, col);
+
+	if (mss_solver_run(solver, 0))
+		return MSS_ERROR;
+
+	return mss_solver_collect(solver, deltas);
+}
+
+/* Whatever has been deduced so far has to hold with the new number too,
+ * i.e. only tiles not yet figured out may have changed.
+ * */
+int mss_solver_renumber(struct mss_solver *solver, int row, int col, int number)
+{
+	struct minesweeper_board *board = &solver->board;
+	unsigned char *tile;
+	int mines = 0;
+	int unknown = 0;
+	int i;
+	int j;
+
+	if (row < 0 || row >= board->rows || col < 0 || col >= board->cols)
+		return MSS_ERROR;
+
+	if (BOARD_AT(board, row, col) > 8 || number < 0 || number > 8)
+		return MSS_ERROR;
+
+	BOARD_FOREACH_NEIGHBOR(board, row, col, i, j, tile) {
+		if (TILE_IS_KNOWN_MINE(*tile))
+			mines++;
+		else if (TILE_IS_OPEN(*tile))
+			unknown++;
+	}
+
+	if (number < mines || number > mines + unknown)
+		return MSS_ERROR;
+
+	BOARD_AT(board, row, col) = number;
+	worklist_push(&solver->worklist, row, col);
+	worklist_push(&solver->dirty, row, col);
+
+	return 0;
+}
+
+static void mss_solver_queue_around(struct mss_solver *solver, int row, int col)
+{
+	unsigned char *tile;
+	int i;
+	int j;
+
+	BOARD_FOREACH_NEIGHBOR(&solver->board, row, col, i, j, tile)
+		if (*tile <= 8)
+			worklist_push(&solver->worklist, row + i, col + j);
+}
+
+/* A window looks at the numbers around it too, so the numbers whose outcome
+ * can depend on row, col are all those up to two steps away.
+ * */
+static void mss_solver_queue_windows(struct mss_solver *solver, int row, int col)
+{
+	struct minesweeper_board *board = &solver->board;
+	unsigned char tile;
+	int i;
+	int j;
+
+	for (i = row - 2; i <= row + 2; i++) {
+		if (i < 0 || i >= board->rows)
+			continue;
+
+		for (j = col - 2; j <= col + 2; j++) {
+			if (j < 0 || j >= board->cols)
+				continue;
+
+			tile = BOARD_AT(board, i, j);
+
+			if (tile <= 8 && tile != 0)
+				worklist_push(&solver->windows, i, j);
+		}
+	}
+}
+
+/* Runs the per-tile rule until it runs dry. Only once that leaves nothing to
+ * click do the window rule, on whatever changed since it last ran, and the
+ * frontier get a go, going back to the start whenever they deduce anything.
+ * With full set they get one even while earlier deltas are still waiting to
+ * be clicked, which is what an explicit deduce asks for.
+ * */
+static int mss_solver_run(struct mss_solver *solver, int full)
+{
+	struct minesweeper_board *board = &solver->board;
+	struct board_worklist *worklist = &solver->worklist;
+	int logged = 0;		/* Deduced tiles already marked dirty */
+	int progress;
+	int i;
+	int j;
+
+	worklist->n_revealed = 0;
+
+	for (;;) {
+		if (board_deduce_simple(board) == BOARD_SOLVE_BUG)
+			return 1;
+
+		for (; logged < worklist->n_revealed; logged++)
+			worklist_push(&solver->dirty,
+					worklist->revealed[logged] / worklist->cols,
+					worklist->revealed[logged] % worklist->cols);
+
+		if ((solver->outstanding && !full) || worklist->n_revealed)
+			break;
+
+		progress = 0;
+
+		if (solver->flags & MSS_SOLVER_WINDOWS) {
+			if (solver->fresh) {
+				while (worklist_pop(&solver->dirty, &i, &j))
+					;
+
+				switch (board_deduce_windows(board)) {
+				case BOARD_SOLVE_SUCCESS:
+					progress = 1;
+					break;
+				case BOARD_SOLVE_BUG:
+					return 1;
+				}
+
+				solver->fresh = 0;
+			}
+
+			/* Neighboring changes share most of their windows,
+			 * each only needs one look
+			 * */
+			while (worklist_pop(&solver->dirty, &i, &j))
+				mss_solver_queue_windows(solver, i, j);
+
+			while (worklist_pop(&solver->windows, &i, &j)) {
+				switch (board_deduce_window(board, i, j)) {
+				case BOARD_SOLVE_SUCCESS:
+					progress = 1;
+					break;
+				case BOARD_SOLVE_BUG:
+					return 1;
+				}
+			}
+		}
+
+		if (progress)
+			continue;
+
+		if (!(solver->flags & MSS_SOLVER_FRONTIER))
+			break;
+
+		switch (board_deduce_frontier(board)) {
+		case BOARD_SOLVE_SUCCESS:
+			continue;
+		case BOARD_SOLVE_BUG:
+			return 1;
+		}
+
+		break;
+	}
+
+	return 0;
+}
+
+/* Turns the tiles deduced by the last run into deltas */
+static int mss_solver_collect(struct mss_solver *solver, const struct mss_delta **deltas)
+{
+	struct board_worklist *worklist = &solver->worklist;
+	struct mss_delta *delta;
+	int idx;
+	int i;
+
+	solver->n_deltas = 0;
+
+	for (i = 0; i < worklist->n_revealed; i++) {
+		idx = worklist->revealed[i];
+		delta = &solver->deltas[solver->n_deltas++];
+		delta->row = idx / worklist->cols;
+		delta->col = idx % worklist->cols;
+		delta->mine = TILE_IS_MINE(BOARD_AT(&solver->board, delta->row, delta->col));
+	}
+
+	worklist->n_revealed = 0;
+	solver->outstanding += solver->n_deltas;
+
+	if (deltas)
+		*deltas = solver->deltas;
+
+	return solver->n_deltas;
+}
@@ -0,0 +1,54 @@
+#ifndef MINESWEEPER_SOLVER_MSS_H
+#define MINESWEEPER_SOLVER_MSS_H
+
+#include "board.h"
+
+/* Incremental solver. A context owns a copy of a partial board and keeps its
+ * work queue and deduction cache alive between calls, so every observation
+ * only costs as much as the part of the board it touches. Contexts share
+ * nothing, so separate contexts can be used from separate threads.
+ * */
+
+/* Rules to run once the cheap per-tile rule runs dry */
+#define MSS_SOLVER_WINDOWS	(1 << 0)	/* 3x3 windows around changed tiles */
+#define MSS_SOLVER_FRONTIER	(1 << 1)	/* The whole frontier, once nothing is left to click */
+#define MSS_SOLVER_DEFAULT	(MSS_SOLVER_WINDOWS | MSS_SOLVER_FRONTIER)
+
+#define MSS_ERROR	(-1)
+
+/* A tile the solver has newly figured out */
+struct mss_delta {
+	int row;
+	int col;
+	int mine;
+};
+
+struct mss_solver;
+
+struct mss_solver *mss_solver_create(const struct minesweeper_board *board, int flags);
+void mss_solver_destroy(struct mss_solver *solver);
+const struct minesweeper_board *mss_solver_board(const struct mss_solver *solver);
+
+/* Each returns the number of deltas and points deltas at them, or returns
+ * MSS_ERROR if the observation contradicts the board. Deltas stay valid until
+ * the next call on the same context.
+ *
+ * reveal and flag hold the costlier rules back while deltas from earlier
+ * calls are still waiting to be revealed or flagged, since those usually
+ * give the cheap rule more to go on. deduce always runs every rule, so
+ * calling it again without applying its deltas goes on to them.
+ * */
+int mss_solver_deduce(struct mss_solver *solver, const struct mss_delta **deltas);
+int mss_solver_reveal(struct mss_solver *solver, int row, int col, int number,
+		const struct mss_delta **deltas);
+int mss_solver_flag(struct mss_solver *solver, int row, int col,
+		const struct mss_delta **deltas);
+
+/* For callers that move mines around under the solver, e.g. generators.
+ * Changes the number of a revealed tile without deducing anything; the next
+ * call picks it up. Returns MSS_ERROR if the tile is not revealed or the
+ * number can not be right.
+ * */
+int mss_solver_renumber(struct mss_solver *solver, int row, int col, int number);
+
+#endif /* MINESWEEPER_SOLVER_MSS_H */
@@ -0,0 +1,441 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "buf.h"
+#include "frontier.h"
+#include "prob.h"
+
+/* Search nodes one call of prob_compute() gets over all of its components */
+#define PROB_BUDGET (1L << 24)
+
+/* Components bigger than this are not enumerated, they would need more than
+ * MAX_CELLS squared layout counts
+ * */
+#define PROB_MAX_CELLS 1024
+
+/* Layouts of one component, by the number of mines they hold. cell_counts
+ * holds, for every mine count k, in how many of those layouts each cell is a
+ * mine, n_cells entries per k.
+ * */
+struct prob_component_s {
+	double *counts;
+	double *cell_counts;
+};
+
+static void prob_binomial_weights(double *weights, int n_frontier, int n_interior, int remaining);
+static void prob_convolve(const double *a, int len_a, const double *b, int len_b, double *out);
+static int prob_count_layout(
+		const struct frontier *frontier,
+		const struct frontier_component *component,
+		const unsigned char *mines,
+		int n_mines,
+		void *ctx);
+static void prob_normalize(double *values, int length);
+
+/* Works out how likely each unknown tile is to hold a mine, assuming every
+ * layout of mines that agrees with the board is equally likely.
+ *
+ * The frontier is split into components that are enumerated on their own,
+ * counting layouts by how many mines they hold. If total_mines is known, a
+ * frontier layout with m mines in total leaves the rest of the mines to the
+ * interior tiles, which can hold them in C(interior, rest) ways, and layouts
+ * are weighted by that. Otherwise components are independent and interior
+ * tiles are left at -1.
+ *
+ * probabilities gets one entry per tile, row * cols + col, with -1 for tiles
+ * that are not unknown. Returns PROB_NO_LAYOUT if no layout fits the board and
+ * PROB_TOO_MANY_LAYOUTS if a component is too big or the layouts take more
+ * than PROB_BUDGET search nodes to walk.
+ * */
+int prob_compute(const struct minesweeper_board *board, int total_mines, double *probabilities)
+{
+	struct prob_component_s *components = NULL;
+	const struct frontier_component *component;
+	struct frontier_cell *cell;
+	struct frontier frontier;
+	double *weights = NULL;
+	double *suffix = NULL;
+	double *prefix = NULL;
+	double *rest = NULL;
+	double *scratch = NULL;
+	double *g = NULL;
+	int *suffix_at = NULL;
+	long budget = PROB_BUDGET;
+	double sum;
+	double z;
+	int prefix_len;
+	int remaining;
+	int ret = PROB_NO_LAYOUT;
+	int n;
+	int c;
+	int i;
+	int j;
+	int k;
+
+	if (frontier_build(&frontier, board))
+		return PROB_NO_LAYOUT;
+
+	for (i = 0; i < board->rows; i++)
+		for (j = 0; j < board->cols; j++)
+			probabilities[i * board->cols + j] = -1;
+
+	components = calloc(frontier.n_components + 1, sizeof(components[0]));
+
+	if (!components)
+		goto end;
+
+	for (c = 0; c < frontier.n_components; c++) {
+		component = &frontier.components[c];
+		n = component->n_cells;
+
+		if (n > PROB_MAX_CELLS) {
+			ret = PROB_TOO_MANY_LAYOUTS;
+			goto end;
+		}
+
+		components[c].counts = calloc(n + 1, sizeof(double));
+		components[c].cell_counts = calloc((size_t)(n + 1) * n, sizeof(double));
+
+		if (!components[c].counts || !components[c].cell_counts)
+			goto end;
+
+		if (frontier_enumerate(&frontier, component, &budget, prob_count_layout,
+					&components[c])) {
+			if (budget <= 0)
+				ret = PROB_TOO_MANY_LAYOUTS;
+
+			goto end;
+		}
+
+		/* Scaling a component changes every weight by the same factor,
+		 * so it does not matter for the outcome but keeps it in range.
+		 * */
+		sum = 0;
+
+		for (k = 0; k <= n; k++)
+			if (components[c].counts[k] > sum)
+				sum = components[c].counts[k];
+
+		if (sum == 0)
+			goto end;
+
+		for (k = 0; k <= n; k++)
+			components[c].counts[k] /= sum;
+
+		for (k = 0; k < (n + 1) * n; k++)
+			components[c].cell_counts[k] /= sum;
+	}
+
+	if (total_mines < 0) {
+		for (c = 0; c < frontier.n_components; c++) {
+			component = &frontier.components[c];
+			n = component->n_cells;
+			z = 0;
+
+			for (k = 0; k <= n; k++)
+				z += components[c].counts[k];
+
+			for (i = 0; i < n; i++) {
+				cell = &frontier.cells[component->first_cell + i];
+				sum = 0;
+
+				for (k = 0; k <= n; k++)
+					sum += components[c].cell_counts[k * n + i];
+
+				probabilities[cell->row * board->cols + cell->col] = sum / z;
+			}
+		}
+
+		ret = PROB_SUCCESS;
+		goto end;
+	}
+
+	remaining = total_mines - frontier.n_known_mines;
+
+	if (remaining < 0 || remaining > frontier.n_cells + frontier.n_interior)
+		goto end;
+
+	weights = calloc(frontier.n_cells + 1, sizeof(weights[0]));
+	suffix_at = malloc((frontier.n_components + 1) * sizeof(suffix_at[0]));
+	prefix = malloc((frontier.n_cells + 1) * sizeof(prefix[0]));
+	rest = malloc((frontier.n_cells + 1) * sizeof(rest[0]));
+	scratch = malloc((frontier.n_cells + 1) * sizeof(scratch[0]));
+	g = malloc((frontier.n_cells + 1) * sizeof(g[0]));
+
+	if (!weights || !suffix_at || !prefix || !rest || !scratch || !g)
+		goto end;
+
+	prob_binomial_weights(weights, frontier.n_cells, frontier.n_interior, remaining);
+
+	/* Mine count distributions of components c through the last one, for
+	 * every c, so the distribution of everything but one component is a prefix
+	 * times a suffix. Suffix c starts at suffix[suffix_at[c]] and is as long
+	 * as the cells of components c and up plus one.
+	 * */
+	suffix_at[frontier.n_components] = 0;
+	n = 1;
+
+	for (c = frontier.n_components - 1; c >= 0; c--)
+		n += frontier.n_cells - frontier.components[c].first_cell + 1;
+
+	suffix = malloc(n * sizeof(suffix[0]));
+
+	if (!suffix)
+		goto end;
+
+	suffix[0] = 1;
+	n = 1;
+
+	for (c = frontier.n_components - 1; c >= 0; c--) {
+		component = &frontier.components[c];
+		suffix_at[c] = n;
+
+		prob_convolve(components[c].counts, component->n_cells + 1,
+				&suffix[suffix_at[c + 1]], frontier.n_cells - component->first_cell
+					- component->n_cells + 1,
+				&suffix[n]);
+
+		n += frontier.n_cells - component->first_cell + 1;
+		prob_normalize(&suffix[suffix_at[c]], frontier.n_cells - component->first_cell + 1);
+	}
+
+	prefix[0] = 1;
+	prefix_len = 1;
+
+	for (c = 0; c < frontier.n_components; c++) {
+		component = &frontier.components[c];
+		n = component->n_cells;
+
+		/* rest[m] ~ layouts of all other components with m mines */
+		prob_convolve(prefix, prefix_len,
+				&suffix[suffix_at[c + 1]], frontier.n_cells - component->first_cell - n + 1,
+				rest);
+
+		/* g[k] ~ ways to complete a layout of this component holding
+		 * k mines into one of the whole board
+		 * */
+		for (k = 0; k <= n; k++) {
+			g[k] = 0;
+
+			for (j = 0; j + k <= frontier.n_cells && j < frontier.n_cells - n + 1; j++)
+				g[k] += rest[j] * weights[j + k];
+		}
+
+		z = 0;
+
+		for (k = 0; k <= n; k++)
+			z += components[c].counts[k] * g[k];
+
+		if (z == 0)
+			goto end;
+
+		for (i = 0; i < n; i++) {
+			cell = &frontier.cells[component->first_cell + i];
+			sum = 0;
+
+			for (k = 0; k <= n; k++)
+				sum += components[c].cell_counts[k * n + i] * g[k];
+
+			probabilities[cell->row * board->cols + cell->col] = sum / z;
+		}
+
+		prob_convolve(prefix, prefix_len, components[c].counts, n + 1, scratch);
+		prefix_len += n;
+		memcpy(prefix, scratch, prefix_len * sizeof(prefix[0]));
+		prob_normalize(prefix, prefix_len);
+	}
+
+	/* prefix now covers the whole frontier */
+	if (frontier.n_interior) {
+		z = 0;
+		sum = 0;
+
+		for (k = 0; k < prefix_len; k++) {
+			z += prefix[k] * weights[k];
+			sum += prefix[k] * weights[k] * (remaining - k);
+		}
+
+		if (z == 0)
+			goto end;
+
+		for (i = 0; i < board->rows; i++) {
+			for (j = 0; j < board->cols; j++) {
+				if (!TILE_IS_OPEN(BOARD_AT(board, i, j)))
+					continue;
+
+				if (probabilities[i * board->cols + j] < 0)
+					probabilities[i * board->cols + j] = sum / z / frontier.n_interior;
+			}
+		}
+	}
+
+	ret = PROB_SUCCESS;
+
+end:
+	if (components) {
+		for (c = 0; c < frontier.n_components; c++) {
+			free(components[c].counts);
+			free(components[c].cell_counts);
+		}
+	}
+
+	free(components);
+	free(weights);
+	free(suffix);
+	free(suffix_at);
+	free(prefix);
+	free(rest);
+	free(scratch);
+	free(g);
+	frontier_destroy(&frontier);
+
+	return ret;
+}
+
+static int prob_count_layout(
+		const struct frontier *frontier,
+		const struct frontier_component *component,
+		const unsigned char *mines,
+		int n_mines,
+		void *ctx)
+{
+	struct prob_component_s *counts = ctx;
+	double *cell_counts;
+	int i;
+
+	(void)frontier;
+
+	counts->counts[n_mines]++;
+	cell_counts = &counts->cell_counts[n_mines * component->n_cells];
+
+	for (i = 0; i < component->n_cells; i++)
+		cell_counts[i] += mines[i];
+
+	return 0;
+}
+
+/* weights[m] ~ C(n_interior, remaining - m), the number of ways to place the
+ * mines a frontier layout with m mines leaves over. Only ratios matter, so the
+ * largest one is 1 and the rest are walked to from there one factor at a
+ * time, which never overflows.
+ * */
+static void prob_binomial_weights(double *weights, int n_frontier, int n_interior, int remaining)
+{
+	int lo = remaining - n_interior > 0 ? remaining - n_interior : 0;
+	int hi = remaining < n_frontier ? remaining : n_frontier;
+	int mode;
+	int m;
+
+	for (m = 0; m <= n_frontier; m++)
+		weights[m] = 0;
+
+	if (lo > hi)
+		return;
+
+	mode = remaining - n_interior / 2;
+	mode = mode < lo ? lo : mode > hi ? hi : mode;
+	weights[mode] = 1;
+
+	for (m = mode + 1; m <= hi; m++)
+		weights[m] = weights[m - 1] * (remaining - m + 1) / (n_interior - remaining + m);
+
+	for (m = mode - 1; m >= lo; m--)
+		weights[m] = weights[m + 1] * (n_interior - remaining + m + 1) / (remaining - m);
+}
+
+/* out gets len_a + len_b - 1 entries */
+static void prob_convolve(const double *a, int len_a, const double *b, int len_b, double *out)
+{
+	int i;
+	int j;
+
+	for (i = 0; i < len_a + len_b - 1; i++)
+		out[i] = 0;
+
+	for (i = 0; i < len_a; i++) {
+		if (a[i] == 0)
+			continue;
+
+		for (j = 0; j < len_b; j++)
+			out[i + j] += a[i] * b[j];
+	}
+}
+
+static void prob_normalize(double *values, int length)
+{
+	double max = 0;
+	int i;
+
+	for (i = 0; i < length; i++)
+		if (values[i] > max)
+			max = values[i];
+
+	if (max == 0)
+		return;
+
+	for (i = 0; i < length; i++)
+		values[i] /= max;
+}
+
+/* Picks the unknown tile least likely to be a mine. Ties go to the tile that
+ * comes first. Returns its probability, or -1 if there is none.
+ * */
+double prob_best_guess(const struct minesweeper_board *board, const double *probabilities,
+		int *row, int *col)
+{
+	double best = -1;
+	double p;
+	int i;
+	int j;
+
+	for (i = 0; i < board->rows; i++) {
+		for (j = 0; j < board->cols; j++) {
+			p = probabilities[i * board->cols + j];
+
+			if (p < 0 || (best >= 0 && p >= best))
+				continue;
+
+			best = p;
+			*row = i;
+			*col = j;
+		}
+	}
+
+	return best;
+}
+
+/* Prints the board with every unknown tile replaced by the percent chance of
+ * it being a mine, or ? if that is not known.
+ * */
+int prob_to_string_buf(const struct minesweeper_board *board, const double *probabilities,
+		struct gr_buffer *out)
+{
+	unsigned char tile;
+	double p;
+	int i;
+	int j;
+
+	for (i = 0; i < board->rows; i++) {
+		for (j = 0; j < board->cols; j++) {
+			tile = BOARD_AT(board, i, j);
+			p = probabilities[i * board->cols + j];
+
+			if (TILE_IS_OPEN(tile)) {
+				if (p < 0)
+					BUF_APPEND_STR(out, "   ?");
+				else
+					buf_printf(out, " %3i", (int)(p * 100 + 0.5));
+			} else if (TILE_IS_MINE(tile)) {
+				BUF_APPEND_STR(out, "   #");
+			} else if (TILE_NEIGHBOR_MINES(tile)) {
+				buf_printf(out, "   %i", TILE_NEIGHBOR_MINES(tile));
+			} else {
+				BUF_APPEND_STR(out, "   .");
+			}
+		}
+
+		gr_buf_append_char(out, '\n');
+	}
+
+	return 0;
+}
@@ -0,0 +1,18 @@
+#ifndef MINESWEEPER_SOLVER_PROB_H
+#define MINESWEEPER_SOLVER_PROB_H
+
+#include <gramas/buf.h>
+
+#include "board.h"
+
+#define PROB_SUCCESS		0
+#define PROB_NO_LAYOUT		1	/* No layout fits, or out of memory */
+#define PROB_TOO_MANY_LAYOUTS	2	/* Gave up before seeing them all */
+
+int prob_compute(const struct minesweeper_board *board, int total_mines, double *probabilities);
+double prob_best_guess(const struct minesweeper_board *board, const double *probabilities,
+		int *row, int *col);
+int prob_to_string_buf(const struct minesweeper_board *board, const double *probabilities,
+		struct gr_buffer *out);
+
+#endif /* MINESWEEPER_SOLVER_PROB_H */
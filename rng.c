@@ -0,0 +1,100 @@
+#include "rng.h"
+
+static inline uint64_t rotl(uint64_t x, int k)
+{
+	return (x << k) | (x >> (64 - k));
+}
+
+void rng_seed(struct rng *rng, uint64_t seed)
+{
+	uint64_t z;
+	int i;
+
+	for (i = 0; i < 4; i++) {
+		seed += 0x9E3779B97F4A7C15ULL;
+		z = seed;
+		z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+		z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+		rng->s[i] = z ^ (z >> 31);
+	}
+}
+
+uint64_t rng_next(struct rng *rng)
+{
+	uint64_t *s = rng->s;
+	uint64_t ret;
+	uint64_t t;
+
+	ret = rotl(s[1] * 5, 7) * 9;
+	t = s[1] << 17;
+
+	s[2] ^= s[0];
+	s[3] ^= s[1];
+	s[1] ^= s[2];
+	s[0] ^= s[3];
+	s[2] ^= t;
+	s[3] = rotl(s[3], 45);
+
+	return ret;
+}
+
+/* Uniform in [0, bound). Lemire's multiply and reject. */
+uint32_t rng_below(struct rng *rng, uint32_t bound)
+{
+	uint64_t m;
+	uint32_t low;
+	uint32_t threshold;
+
+	m = (rng_next(rng) >> 32) * bound;
+	low = (uint32_t)m;
+
+	if (low < bound) {
+		threshold = -bound % bound;
+
+		while (low < threshold) {
+			m = (rng_next(rng) >> 32) * bound;
+			low = (uint32_t)m;
+		}
+	}
+
+	return (uint32_t)(m >> 32);
+}
+
+/* Uniform in [0, 1) */
+double rng_double(struct rng *rng)
+{
+	return (rng_next(rng) >> 11) * 0x1.0p-53;
+}
+
+/* Skips ahead 2^128 numbers. Calling it once more for every extra thread
+ * gives each of them a sequence that never overlaps with the others.
+ * */
+void rng_jump(struct rng *rng)
+{
+	static const uint64_t jump[] = {
+		0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL,
+		0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL
+	};
+
+	uint64_t s[4] = { 0 };
+	int i;
+	int b;
+
+	for (i = 0; i < 4; i++) {
+		for (b = 0; b < 64; b++) {
+			if (jump[i] & (1ULL << b)) {
+				s[0] ^= rng->s[0];
+				s[1] ^= rng->s[1];
+				s[2] ^= rng->s[2];
+				s[3] ^= rng->s[3];
+			}
+
+			rng_next(rng);
+		}
+	}
+
+	rng->s[0] = s[0];
+	rng->s[1] = s[1];
+	rng->s[2] = s[2];
+	rng->s[3] = s[3];
+}
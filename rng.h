@@ -0,0 +1,19 @@
+#ifndef MINESWEEPER_SOLVER_RNG_H
+#define MINESWEEPER_SOLVER_RNG_H
+
+#include <stdint.h>
+
+/* xoshiro256** seeded through splitmix64. Same seed, same sequence, on every
+ * platform.
+ * */
+struct rng {
+	uint64_t s[4];
+};
+
+void rng_seed(struct rng *rng, uint64_t seed);
+uint64_t rng_next(struct rng *rng);
+uint32_t rng_below(struct rng *rng, uint32_t bound);
+double rng_double(struct rng *rng);
+void rng_jump(struct rng *rng);
+
+#endif /* MINESWEEPER_SOLVER_RNG_H */
@@ -0,0 +1,589 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <errno.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "buf.h"
+#include "cache.h"
+#include "count.h"
+#include "mss.h"
+#include "prob.h"
+#include "server.h"
+
+/* Requests are a line each, boards follow it as as many bytes as the line
+ * says. Every answer is either "ok <length>" followed by that many bytes or a
+ * single "error <reason>" line, in the order the requests came in.
+ * */
+
+/* Boards bigger than this are refused. Whatever follows can not be told
+ * apart from the board, so the connection is closed.
+ * */
+#define SERVER_MAX_BOARD	(1 << 24)
+
+#define SERVER_MAX_ARGS		4
+#define SERVER_BACKLOG		64
+
+/* Everything a connection needs, sessions included. Nothing is shared between
+ * connections, so each can be served on a thread of its own.
+ * */
+struct server_conn {
+	const struct batch_options *options;
+	FILE *in;
+	int out;
+	int hangup;			/* Out of step with the client */
+
+	char *line;
+	size_t line_cap;
+	struct gr_buffer text;		/* Board of the current request */
+	struct gr_buffer body;		/* Answer to it */
+	struct gr_buffer answer;	/* The same, ready to be written */
+
+	struct deduce_cache cache;
+	struct deduce_cache *cachep;
+
+	struct mss_solver **sessions;	/* Indexed by id, NULL if free */
+	int n_sessions;
+};
+
+typedef const char *(*server_handler)(struct server_conn *conn, const int *args);
+
+static const char *server_solve(struct server_conn *conn, const int *args);
+static const char *server_deduce(struct server_conn *conn, const int *args);
+static const char *server_probabilities(struct server_conn *conn, const int *args);
+static const char *server_count(struct server_conn *conn, const int *args);
+static const char *server_open(struct server_conn *conn, const int *args);
+static const char *server_reveal(struct server_conn *conn, const int *args);
+static const char *server_flag(struct server_conn *conn, const int *args);
+static const char *server_guess(struct server_conn *conn, const int *args);
+static const char *server_close(struct server_conn *conn, const int *args);
+
+static const struct {
+	const char *name;
+	int n_args;
+	server_handler handler;
+} server_requests[] = {
+	{ "solve", 3, server_solve },		/* row col length, full board */
+	{ "deduce", 1, server_deduce },		/* length, partial board */
+	{ "probabilities", 2, server_probabilities },	/* mines length, partial board */
+	{ "count", 2, server_count },		/* mines length, partial board */
+	{ "open", 1, server_open },		/* length, partial board */
+	{ "reveal", 4, server_reveal },		/* id row col number */
+	{ "flag", 3, server_flag },		/* id row col */
+	{ "guess", 2, server_guess },		/* id mines */
+	{ "close", 1, server_close },		/* id */
+};
+
+static int server_serve(FILE *in, int out, const struct batch_options *options);
+static void *server_client(void *arg);
+static int server_answer(struct server_conn *conn, const char *error);
+static int server_write(int fd, const char *data, size_t length);
+static int server_read_board(struct server_conn *conn, int length,
+		struct minesweeper_board *board);
+static struct mss_solver *server_session(struct server_conn *conn, int id);
+static const char *server_deltas(struct server_conn *conn, int n, const struct mss_delta *deltas);
+
+struct server_client_s {
+	const struct batch_options *options;
+	int fd;
+};
+
+/* Serves requests on standard input and output if path is "-", or else on
+ * a Unix domain socket at path, every client on a thread of its own. Only
+ * returns if the socket can not be set up or stops accepting clients.
+ * */
+int server_run(const char *path, const struct batch_options *options)
+{
+	struct server_client_s *client;
+	struct sockaddr_un addr;
+	struct sigaction ignore;
+	struct stat st;
+	pthread_attr_t attr;
+	pthread_t thread;
+	int listener = -1;
+	int ret = 1;
+	int fd;
+
+	/* A client hanging up mid-answer is an error on its connection only */
+	memset(&ignore, 0, sizeof(ignore));
+	ignore.sa_handler = SIG_IGN;
+	sigaction(SIGPIPE, &ignore, NULL);
+
+	if (!strcmp(path, "-"))
+		return server_serve(stdin, STDOUT_FILENO, options);
+
+	if (strlen(path) >= sizeof(addr.sun_path)) {
+		fprintf(stderr, "Socket path too long: %s\n", path);
+		return 1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	/* Left over from an earlier run. Anything else is not ours to remove. */
+	if (!stat(path, &st) && S_ISSOCK(st.st_mode))
+		unlink(path);
+
+	if (pthread_attr_init(&attr))
+		return 1;
+
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+	if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr))
+			|| listen(listener, SERVER_BACKLOG)) {
+		perror(path);
+		goto end;
+	}
+
+	for (;;) {
+		fd = accept(listener, NULL, NULL);
+
+		if (fd < 0) {
+			if (errno == EINTR || errno == ECONNABORTED)
+				continue;
+
+			perror(path);
+			goto end;
+		}
+
+		client = malloc(sizeof(*client));
+
+		if (!client) {
+			close(fd);
+			continue;
+		}
+
+		client->options = options;
+		client->fd = fd;
+
+		if (pthread_create(&thread, &attr, server_client, client)) {
+			close(fd);
+			free(client);
+		}
+	}
+
+end:
+	if (listener >= 0)
+		close(listener);
+
+	pthread_attr_destroy(&attr);
+
+	return ret;
+}
+
+static void *server_client(void *arg)
+{
+	struct server_client_s *client = arg;
+	FILE *in = fdopen(client->fd, "r");
+
+	if (in) {
+		server_serve(in, client->fd, client->options);
+		fclose(in);
+	} else {
+		close(client->fd);
+	}
+
+	free(client);
+
+	return NULL;
+}
+
+/* Answers requests from in until it runs out or the client can not be
+ * followed any more. Returns non-zero in the latter case.
+ * */
+static int server_serve(FILE *in, int out, const struct batch_options *options)
+{
+	struct server_conn conn;
+	int args[SERVER_MAX_ARGS];
+	char name[16];
+	const char *error;
+	int n;
+	int i;
+
+	memset(&conn, 0, sizeof(conn));
+	conn.options = options;
+	conn.in = in;
+	conn.out = out;
+	gr_buf_init(&conn.text, 4096);
+	gr_buf_init(&conn.body, 4096);
+	gr_buf_init(&conn.answer, 4096);
+
+	if (!deduce_cache_init(&conn.cache, DEDUCE_CACHE_DEFAULT_SIZE))
+		conn.cachep = &conn.cache;
+
+	while (!conn.hangup && getline(&conn.line, &conn.line_cap, in) >= 0) {
+		n = sscanf(conn.line, "%15s %i %i %i %i", name, &args[0], &args[1], &args[2], &args[3]);
+
+		/* Blank lines keep interactive sessions readable */
+		if (n <= 0)
+			continue;
+
+		gr_buf_clear(&conn.body);
+		error = "unknown request";
+
+		for (i = 0; i < (int)(sizeof(server_requests) / sizeof(server_requests[0])); i++) {
+			if (strcmp(name, server_requests[i].name))
+				continue;
+
+			if (n - 1 == server_requests[i].n_args)
+				error = server_requests[i].handler(&conn, args);
+			else
+				error = "wrong number of arguments";
+
+			break;
+		}
+
+		if (server_answer(&conn, error))
+			break;
+	}
+
+	for (i = 0; i < conn.n_sessions; i++)
+		mss_solver_destroy(conn.sessions[i]);
+
+	free(conn.sessions);
+	free(conn.line);
+	gr_buf_delete(&conn.text);
+	gr_buf_delete(&conn.body);
+	gr_buf_delete(&conn.answer);
+	deduce_cache_destroy(&conn.cache);
+
+	return conn.hangup;
+}
+
+/* Writes the answer in one go, so that clients pipelining requests do not
+ * wait on a half written one.
+ * */
+static int server_answer(struct server_conn *conn, const char *error)
+{
+	gr_buf_clear(&conn->answer);
+
+	if (error) {
+		buf_printf(&conn->answer, "error %s\n", error);
+	} else {
+		buf_printf(&conn->answer, "ok %zu\n", conn->body.length);
+		gr_buf_append(&conn->answer, conn->body.buf, conn->body.length);
+	}
+
+	return server_write(conn->out, conn->answer.buf, conn->answer.length);
+}
+
+static int server_write(int fd, const char *data, size_t length)
+{
+	ssize_t written;
+
+	while (length) {
+		written = write(fd, data, length);
+
+		if (written < 0) {
+			if (errno == EINTR)
+				continue;
+
+			return 1;
+		}
+
+		data += written;
+		length -= written;
+	}
+
+	return 0;
+}
+
+/* Reads length bytes of board. Returns non-zero, and gives up on the
+ * connection, if the length makes no sense or the board is cut short.
+ * */
+static int server_read_board(struct server_conn *conn, int length,
+		struct minesweeper_board *board)
+{
+	char chunk[4096];
+	size_t got;
+
+	if (length <= 0 || length > SERVER_MAX_BOARD) {
+		conn->hangup = 1;
+		return 1;
+	}
+
+	gr_buf_clear(&conn->text);
+
+	while (length) {
+		got = fread(chunk, 1, length < (int)sizeof(chunk) ? (size_t)length : sizeof(chunk), conn->in);
+
+		if (!got) {
+			conn->hangup = 1;
+			return 1;
+		}
+
+		gr_buf_append(&conn->text, chunk, got);
+		length -= (int)got;
+	}
+
+	board_read_buf(board, conn->text.buf, conn->text.length);
+	board->cache = conn->cachep;
+	board->pipeline = conn->options->pipeline;
+
+	return 0;
+}
+
+static const char *server_solve(struct server_conn *conn, const int *args)
+{
+	struct minesweeper_board board;
+	struct batch_options options = *conn->options;
+	const char *error = NULL;
+
+	if (server_read_board(conn, args[2], &board))
+		return "bad board length";
+
+	options.row = args[0];
+	options.col = args[1];
+
+	if (!board_is_full(&board))
+		error = "not a full board";
+	else if (options.row < 0 || options.row >= board.rows
+			|| options.col < 0 || options.col >= board.cols
+			|| BOARD_AT(&board, options.row, options.col) != TILE_CLEAR)
+		error = "starting point is not clear";
+	else if (batch_solve_one(&board, &options, &conn->body))
+		error = "solver failed";
+
+	board_destroy(&board);
+
+	return error;
+}
+
+static const char *server_deduce(struct server_conn *conn, const int *args)
+{
+	struct minesweeper_board board;
+	struct batch_options options = *conn->options;
+	const char *error = NULL;
+
+	if (server_read_board(conn, args[0], &board))
+		return "bad board length";
+
+	/* Asked for separately */
+	options.probabilities = 0;
+
+	if (!board_is_partial(&board))
+		error = "not a partial board";
+	else if (batch_solve_one(&board, &options, &conn->body))
+		error = "board mine numbers inconsistent";
+
+	board_destroy(&board);
+
+	return error;
+}
+
+static const char *server_probabilities(struct server_conn *conn, const int *args)
+{
+	struct minesweeper_board board;
+	const char *error = NULL;
+
+	if (server_read_board(conn, args[1], &board))
+		return "bad board length";
+
+	if (batch_guess(&board, args[0], &conn->body))
+		error = "no mine layout fits the board";
+
+	board_destroy(&board);
+
+	return error;
+}
+
+/* The number of mine layouts that fit the board, in decimal */
+static const char *server_count(struct server_conn *conn, const int *args)
+{
+	struct minesweeper_board board;
+	struct bignum count;
+	const char *error = NULL;
+
+	if (server_read_board(conn, args[1], &board))
+		return "bad board length";
+
+	bignum_init(&count);
+
+	if (count_solutions(&board, args[0], &count)) {
+		error = "out of memory";
+	} else {
+		bignum_to_string_buf(&count, &conn->body);
+		gr_buf_append_char(&conn->body, '\n');
+	}
+
+	bignum_destroy(&count);
+	board_destroy(&board);
+
+	return error;
+}
+
+/* Starts a session on a partial board. The answer is the id of the session
+ * followed by whatever can be deduced right away.
+ * */
+static const char *server_open(struct server_conn *conn, const int *args)
+{
+	struct minesweeper_board board;
+	struct mss_solver **sessions;
+	struct mss_solver *solver = NULL;
+	const struct mss_delta *deltas;
+	const char *error = NULL;
+	int id;
+	int n;
+
+	if (server_read_board(conn, args[0], &board))
+		return "bad board length";
+
+	if (!board_is_partial(&board) || !board_mine_numbers_consistent(&board)) {
+		error = "board mine numbers inconsistent";
+		goto end;
+	}
+
+	for (id = 0; id < conn->n_sessions && conn->sessions[id]; id++)
+		;
+
+	if (id == conn->n_sessions) {
+		sessions = realloc(conn->sessions, (id + 1) * sizeof(sessions[0]));
+
+		if (!sessions) {
+			error = "out of memory";
+			goto end;
+		}
+
+		sessions[id] = NULL;
+		conn->sessions = sessions;
+		conn->n_sessions++;
+	}
+
+	solver = mss_solver_create(&board, MSS_SOLVER_DEFAULT);
+
+	if (!solver) {
+		error = "out of memory";
+		goto end;
+	}
+
+	n = mss_solver_deduce(solver, &deltas);
+
+	if (n == MSS_ERROR) {
+		mss_solver_destroy(solver);
+		error = "board contradicts itself";
+		goto end;
+	}
+
+	conn->sessions[id] = solver;
+	buf_printf(&conn->body, "%i\n", id);
+	error = server_deltas(conn, n, deltas);
+
+end:
+	board_destroy(&board);
+
+	return error;
+}
+
+static const char *server_reveal(struct server_conn *conn, const int *args)
+{
+	struct mss_solver *solver = server_session(conn, args[0]);
+	const struct mss_delta *deltas;
+	int n;
+
+	if (!solver)
+		return "no such session";
+
+	n = mss_solver_reveal(solver, args[1], args[2], args[3], &deltas);
+
+	return server_deltas(conn, n, deltas);
+}
+
+static const char *server_flag(struct server_conn *conn, const int *args)
+{
+	struct mss_solver *solver = server_session(conn, args[0]);
+	const struct mss_delta *deltas;
+	int n;
+
+	if (!solver)
+		return "no such session";
+
+	n = mss_solver_flag(solver, args[1], args[2], &deltas);
+
+	return server_deltas(conn, n, deltas);
+}
+
+/* The safest tile to click as "<row> <col> <probability>", nothing if every
+ * tile is known
+ * */
+static const char *server_guess(struct server_conn *conn, const int *args)
+{
+	struct mss_solver *solver = server_session(conn, args[0]);
+	const struct minesweeper_board *board;
+	const char *error = NULL;
+	double *probabilities;
+	double best;
+	int row;
+	int col;
+	int ret;
+
+	if (!solver)
+		return "no such session";
+
+	board = mss_solver_board(solver);
+	probabilities = malloc((size_t)board->rows * board->cols * sizeof(probabilities[0]));
+
+	if (!probabilities)
+		return "out of memory";
+
+	ret = prob_compute(board, args[1], probabilities);
+
+	if (ret == PROB_TOO_MANY_LAYOUTS) {
+		error = "too many mine layouts to weigh";
+	} else if (ret) {
+		error = "no mine layout fits the board";
+	} else {
+		best = prob_best_guess(board, probabilities, &row, &col);
+
+		if (best >= 0)
+			buf_printf(&conn->body, "%i %i %.6f\n", row, col, best);
+	}
+
+	free(probabilities);
+
+	return error;
+}
+
+static const char *server_close(struct server_conn *conn, const int *args)
+{
+	struct mss_solver *solver = server_session(conn, args[0]);
+
+	if (!solver)
+		return "no such session";
+
+	mss_solver_destroy(solver);
+	conn->sessions[args[0]] = NULL;
+
+	return NULL;
+}
+
+static struct mss_solver *server_session(struct server_conn *conn, int id)
+{
+	if (id < 0 || id >= conn->n_sessions)
+		return NULL;
+
+	return conn->sessions[id];
+}
+
+/* One "<row> <col> mine|clear" line per delta */
+static const char *server_deltas(struct server_conn *conn, int n, const struct mss_delta *deltas)
+{
+	int i;
+
+	if (n == MSS_ERROR)
+		return "contradicts the board";
+
+	for (i = 0; i < n; i++)
+		buf_printf(&conn->body, "%i %i %s\n", deltas[i].row, deltas[i].col,
+				deltas[i].mine ? "mine" : "clear");
+
+	return NULL;
+}
@@ -0,0 +1,8 @@
+#ifndef MINESWEEPER_SOLVER_SERVER_H
+#define MINESWEEPER_SOLVER_SERVER_H
+
+#include "batch.h"
+
+int server_run(const char *path, const struct batch_options *options);
+
+#endif /* MINESWEEPER_SOLVER_SERVER_H */
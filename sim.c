@@ -0,0 +1,422 @@
+#include <errno.h>
+#include <limits.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "gen.h"
+#include "mss.h"
+#include "prob.h"
+#include "rng.h"
+#include "sim.h"
+
+/* Mine density of sizes given as rows x cols, the same as expert */
+#define SIM_DEFAULT_DENSITY	0.206
+
+/* Probabilities closer than this are taken to be the same. They are sums of
+ * many layouts and can come out a few bits apart when they should not.
+ * */
+#define SIM_PROB_TIE		1e-9
+
+enum sim_outcome_e {
+	SIM_LOSS,
+	SIM_WIN,
+	SIM_ERROR,
+};
+
+const char *const sim_policy_names[SIM_N_POLICIES] = {
+	"random",
+	"safest",
+	"corners",
+};
+
+static const struct {
+	const char *name;
+	int rows;
+	int cols;
+	int mines;
+} sim_sizes[] = {
+	{ "beginner", 9, 9, 10 },
+	{ "intermediate", 16, 16, 40 },
+	{ "expert", 16, 30, 99 },
+};
+
+/* Every worker plays a fixed share of the games on a random sequence of its
+ * own, so the same seed and number of jobs always give the same result.
+ * */
+struct sim_worker_s {
+	const struct sim_options *options;
+	struct rng rng;
+	unsigned long games;
+	struct sim_result result;
+	pthread_t thread;
+};
+
+/* Reused from one game to the next */
+struct sim_scratch_s {
+	struct mss_delta *todo;
+	double *probabilities;
+};
+
+static int sim_size_dim(const char *str, char **end, int *ret);
+static int sim_guess(const struct sim_options *options, int mines, struct rng *rng,
+		const struct minesweeper_board *board, double *probabilities, int *row, int *col);
+static int sim_play(const struct sim_options *options, struct rng *rng,
+		struct sim_scratch_s *scratch, unsigned long *guesses);
+static void *sim_worker(void *arg);
+
+int sim_policy_parse(const char *name, enum sim_policy *policy)
+{
+	int i;
+
+	for (i = 0; i < SIM_N_POLICIES; i++) {
+		if (!strcmp(name, sim_policy_names[i])) {
+			*policy = i;
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* beginner, intermediate and expert come with their usual mine counts, rows x
+ * cols with as many mines as expert has per tile.
+ * */
+int sim_size_parse(const char *name, int *rows, int *cols, int *mines)
+{
+	char *end;
+	int i;
+
+	for (i = 0; i < (int)(sizeof(sim_sizes) / sizeof(sim_sizes[0])); i++) {
+		if (!strcmp(name, sim_sizes[i].name)) {
+			*rows = sim_sizes[i].rows;
+			*cols = sim_sizes[i].cols;
+			*mines = sim_sizes[i].mines;
+			return 0;
+		}
+	}
+
+	if (sim_size_dim(name, &end, rows) || *end != 'x'
+			|| sim_size_dim(end + 1, &end, cols) || *end
+			|| *rows > INT_MAX / *cols)
+		return 1;
+
+	*mines = (int)(SIM_DEFAULT_DENSITY * *rows * *cols + 0.5);
+
+	return 0;
+}
+
+/* Plays options->games games from options->seed on options->jobs threads and
+ * sums up how they went. Returns non-zero if the options make no sense.
+ * */
+int sim_run(const struct sim_options *options, struct sim_result *result)
+{
+	struct sim_worker_s *workers;
+	struct rng rng;
+	int *started;
+	int jobs = options->jobs;
+	int i;
+
+	memset(result, 0, sizeof(*result));
+
+	if (options->rows <= 0 || options->cols <= 0 || options->mines < 0
+			|| options->mines >= options->rows * options->cols
+			|| options->row < 0 || options->row >= options->rows
+			|| options->col < 0 || options->col >= options->cols)
+		return 1;
+
+	if (jobs <= 0)
+		jobs = (int)sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (jobs <= 0)
+		jobs = 1;
+
+	if ((unsigned long)jobs > options->games)
+		jobs = options->games ? (int)options->games : 1;
+
+	workers = calloc(jobs, sizeof(workers[0]));
+	started = calloc(jobs, sizeof(started[0]));
+
+	if (!workers || !started) {
+		free(workers);
+		free(started);
+		return 1;
+	}
+
+	rng_seed(&rng, options->seed);
+
+	for (i = 0; i < jobs; i++) {
+		workers[i].options = options;
+		workers[i].rng = rng;
+		workers[i].games = options->games / jobs + ((unsigned long)i < options->games % jobs);
+		rng_jump(&rng);
+	}
+
+	/* This thread is the first worker. Any that fail to start get their
+	 * games played here too.
+	 * */
+	for (i = 1; i < jobs; i++)
+		started[i] = !pthread_create(&workers[i].thread, NULL, sim_worker, &workers[i]);
+
+	for (i = 0; i < jobs; i++)
+		if (!started[i])
+			sim_worker(&workers[i]);
+
+	for (i = 1; i < jobs; i++)
+		if (started[i])
+			pthread_join(workers[i].thread, NULL);
+
+	for (i = 0; i < jobs; i++) {
+		result->games += workers[i].result.games;
+		result->wins += workers[i].result.wins;
+		result->guesses += workers[i].result.guesses;
+		result->guessed_games += workers[i].result.guessed_games;
+		result->errors += workers[i].result.errors;
+	}
+
+	free(workers);
+	free(started);
+
+	return 0;
+}
+
+/* Wilson score interval of the win rate, z standard deviations wide, e.g.
+ * 1.96 for 95%. Unlike the normal approximation it stays within 0 and 1 and
+ * holds up for win rates close to either.
+ * */
+void sim_wilson(unsigned long wins, unsigned long games, double z, double *low, double *high)
+{
+	double n = games;
+	double p;
+	double center;
+	double spread;
+	double scale;
+
+	if (!games) {
+		*low = 0;
+		*high = 1;
+		return;
+	}
+
+	p = wins / n;
+	scale = 1 + z * z / n;
+	center = (p + z * z / (2 * n)) / scale;
+	spread = z * sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / scale;
+
+	*low = center - spread < 0 ? 0 : center - spread;
+	*high = center + spread > 1 ? 1 : center + spread;
+}
+
+/* A positive decimal number at the start of str, with end pointing past it.
+ * Unlike sscanf() this takes no sign, space or base prefix.
+ * */
+static int sim_size_dim(const char *str, char **end, int *ret)
+{
+	long maybe_ret;
+
+	if (*str < '0' || *str > '9')
+		return 1;
+
+	errno = 0;
+	maybe_ret = strtol(str, end, 10);
+
+	if (errno || maybe_ret <= 0 || maybe_ret > INT_MAX)
+		return 1;
+
+	*ret = (int)maybe_ret;
+
+	return 0;
+}
+
+static void *sim_worker(void *arg)
+{
+	struct sim_worker_s *worker = arg;
+	const struct sim_options *options = worker->options;
+	struct sim_scratch_s scratch;
+	unsigned long guesses;
+	unsigned long i;
+	size_t tiles = (size_t)options->rows * options->cols;
+
+	scratch.todo = malloc(tiles * sizeof(scratch.todo[0]));
+	scratch.probabilities = malloc(tiles * sizeof(scratch.probabilities[0]));
+
+	if (!scratch.todo || !scratch.probabilities) {
+		worker->result.games = worker->games;
+		worker->result.errors = worker->games;
+		goto end;
+	}
+
+	for (i = 0; i < worker->games; i++) {
+		guesses = 0;
+
+		switch (sim_play(options, &worker->rng, &scratch, &guesses)) {
+		case SIM_WIN:
+			worker->result.wins++;
+			break;
+		case SIM_LOSS:
+			break;
+		default:
+			worker->result.errors++;
+			break;
+		}
+
+		worker->result.games++;
+		worker->result.guesses += guesses;
+		worker->result.guessed_games += guesses != 0;
+	}
+
+end:
+	free(scratch.todo);
+	free(scratch.probabilities);
+
+	return NULL;
+}
+
+/* Plays one game out with the incremental solver, revealing or flagging
+ * every tile it deduces like a player would and guessing whenever it gets
+ * stuck. Whatever the solver deduces is checked against the actual board.
+ * */
+static int sim_play(const struct sim_options *options, struct rng *rng,
+		struct sim_scratch_s *scratch, unsigned long *guesses)
+{
+	struct minesweeper_board full;
+	struct minesweeper_board partial;
+	struct mss_solver *solver = NULL;
+	const struct mss_delta *deltas;
+	struct mss_delta delta;
+	int ret = SIM_ERROR;
+	int to_reveal = 0;
+	int mines = 0;
+	int n_todo = 0;
+	int n;
+	int i;
+	int j;
+
+	if (board_generate(&full, options->rows, options->cols, options->mines,
+				options->row, options->col, rng))
+		return SIM_ERROR;
+
+	if (board_generate_opening(&partial, &full, options->row, options->col))
+		goto end;
+
+	for (i = 0; i < full.rows; i++) {
+		for (j = 0; j < full.cols; j++) {
+			if (BOARD_AT(&full, i, j) & TILE_MINE)
+				mines++;
+			else if (BOARD_AT(&partial, i, j) > 8)
+				to_reveal++;
+		}
+	}
+
+	solver = mss_solver_create(&partial, MSS_SOLVER_DEFAULT);
+
+	if (!solver)
+		goto end;
+
+	n = mss_solver_deduce(solver, &deltas);
+
+	for (;;) {
+		if (n == MSS_ERROR)
+			goto end;
+
+		for (i = 0; i < n; i++)
+			scratch->todo[n_todo++] = deltas[i];
+
+		if (!to_reveal) {
+			ret = SIM_WIN;
+			goto end;
+		}
+
+		if (n_todo) {
+			delta = scratch->todo[--n_todo];
+
+			/* The solver got it wrong */
+			if (!(BOARD_AT(&full, delta.row, delta.col) & TILE_MINE) != !delta.mine)
+				goto end;
+		} else {
+			if (sim_guess(options, mines, rng, mss_solver_board(solver),
+						scratch->probabilities, &delta.row, &delta.col))
+				goto end;
+
+			(*guesses)++;
+
+			if (BOARD_AT(&full, delta.row, delta.col) & TILE_MINE) {
+				ret = SIM_LOSS;
+				goto end;
+			}
+
+			delta.mine = 0;
+		}
+
+		if (delta.mine) {
+			n = mss_solver_flag(solver, delta.row, delta.col, &deltas);
+		} else {
+			n = mss_solver_reveal(solver, delta.row, delta.col,
+					board_count_neighbor_mines(&full, delta.row, delta.col), &deltas);
+			to_reveal--;
+		}
+	}
+
+end:
+	mss_solver_destroy(solver);
+	board_destroy(&partial);
+	board_destroy(&full);
+
+	return ret;
+}
+
+/* Picks an unknown tile according to options->policy, at random among equally
+ * good ones. Returns non-zero if there is none.
+ * */
+static int sim_guess(const struct sim_options *options, int mines, struct rng *rng,
+		const struct minesweeper_board *board, double *probabilities, int *row, int *col)
+{
+	double best = 0;
+	double rank;
+	double p;
+	int safest = 0;
+	int seen = 0;
+	int i;
+	int j;
+
+	/* Falls back to random if probabilities can not be had */
+	if (options->policy == SIM_POLICY_SAFEST)
+		safest = prob_compute(board, mines, probabilities) == PROB_SUCCESS;
+
+	for (i = 0; i < board->rows; i++) {
+		for (j = 0; j < board->cols; j++) {
+			if (!TILE_IS_OPEN(BOARD_AT(board, i, j)))
+				continue;
+
+			rank = 0;
+
+			if (safest) {
+				/* Tiles without a probability come after all others */
+				p = probabilities[i * board->cols + j];
+				rank = p < 0 ? -2 : -p;
+			} else if (options->policy == SIM_POLICY_CORNERS) {
+				rank = (i == 0 || i == board->rows - 1)
+					+ (j == 0 || j == board->cols - 1);
+			}
+
+			if (seen && rank < best - SIM_PROB_TIE)
+				continue;
+
+			if (!seen || rank > best + SIM_PROB_TIE) {
+				best = rank;
+				seen = 0;
+			}
+
+			/* Reservoir sampling keeps every candidate equally likely */
+			if (!rng_below(rng, ++seen)) {
+				*row = i;
+				*col = j;
+			}
+		}
+	}
+
+	return !seen;
+}
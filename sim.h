@@ -0,0 +1,42 @@
+#ifndef MINESWEEPER_SOLVER_SIM_H
+#define MINESWEEPER_SOLVER_SIM_H
+
+#include <stdint.h>
+
+/* How to pick a tile once nothing more can be deduced */
+enum sim_policy {
+	SIM_POLICY_RANDOM,	/* Any unknown tile */
+	SIM_POLICY_SAFEST,	/* Least likely to be a mine, see prob.h */
+	SIM_POLICY_CORNERS,	/* Corners, then edges, then anything */
+	SIM_N_POLICIES,
+};
+
+extern const char *const sim_policy_names[SIM_N_POLICIES];
+
+struct sim_options {
+	int rows;
+	int cols;
+	int mines;
+	int row;		/* First click, always safe */
+	int col;
+	unsigned long games;
+	uint64_t seed;
+	int jobs;		/* Worker threads, one per core if 0 */
+	enum sim_policy policy;
+};
+
+/* Plain sums, so results of separate runs can be added up */
+struct sim_result {
+	unsigned long games;
+	unsigned long wins;
+	unsigned long guesses;		/* Survived ones and fatal ones */
+	unsigned long guessed_games;	/* Games that needed at least one guess */
+	unsigned long errors;		/* Games the solver contradicted itself in */
+};
+
+int sim_policy_parse(const char *name, enum sim_policy *policy);
+int sim_size_parse(const char *name, int *rows, int *cols, int *mines);
+int sim_run(const struct sim_options *options, struct sim_result *result);
+void sim_wilson(unsigned long wins, unsigned long games, double z, double *low, double *high);
+
+#endif /* MINESWEEPER_SOLVER_SIM_H */
@@ -0,0 +1,201 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "snapshot.h"
+
+/* Rows are grouped into blocks of about this many tiles. Smaller blocks share
+ * more between snapshots but cost more pointers and comparisons each.
+ * */
+#define SNAPSHOT_BLOCK_TILES	256
+
+/* A block holds its rows the way the board lays them out, from the first
+ * tile of its first row to the last tile of its last one, so that it is
+ * compared and copied in one go. The border columns in between never change.
+ * Tiles follow the header.
+ * */
+struct snapshot_block {
+	int refs;
+	struct snapshot_block *next_free;
+};
+
+/* One block pointer per block of the store follows the header */
+struct board_snapshot {
+	struct snapshot_store *store;
+	struct board_snapshot *next_free;
+};
+
+#define SNAPSHOT_BLOCK_TILES_OF(__block)	((unsigned char *)((__block) + 1))
+#define SNAPSHOT_BLOCKS_OF(__snapshot)		((struct snapshot_block **)((__snapshot) + 1))
+
+static struct snapshot_block *snapshot_block_alloc(struct snapshot_store *store);
+static size_t snapshot_block_span(const struct snapshot_store *store, int block);
+
+void snapshot_store_init(struct snapshot_store *store, const struct minesweeper_board *board)
+{
+	store->rows = board->rows;
+	store->cols = board->cols;
+	store->stride = board->stride;
+	store->block_rows = board->cols > 0 && board->cols < SNAPSHOT_BLOCK_TILES
+		? SNAPSHOT_BLOCK_TILES / board->cols : 1;
+	store->n_blocks = (board->rows + store->block_rows - 1) / store->block_rows;
+	store->free_blocks = NULL;
+	store->free_snapshots = NULL;
+}
+
+void snapshot_store_destroy(struct snapshot_store *store)
+{
+	struct snapshot_block *block;
+	struct board_snapshot *snapshot;
+
+	while ((block = store->free_blocks)) {
+		store->free_blocks = block->next_free;
+		free(block);
+	}
+
+	while ((snapshot = store->free_snapshots)) {
+		store->free_snapshots = snapshot->next_free;
+		free(snapshot);
+	}
+}
+
+/* Saves the tiles of a board shaped like the one the store was set up with.
+ * With a parent from the same store, blocks that read the same on the board
+ * as in the parent are shared with it rather than copied. Returns NULL if
+ * the board does not fit the store or memory runs out.
+ * */
+struct board_snapshot *snapshot_take(struct snapshot_store *store,
+		const struct minesweeper_board *board, const struct board_snapshot *parent)
+{
+	struct board_snapshot *snapshot;
+	struct snapshot_block **blocks;
+	struct snapshot_block *block;
+	const unsigned char *tiles;
+	size_t span;
+	int b;
+
+	if (board->rows != store->rows || board->cols != store->cols
+			|| board->stride != store->stride)
+		return NULL;
+
+	if ((snapshot = store->free_snapshots)) {
+		store->free_snapshots = snapshot->next_free;
+	} else {
+		snapshot = malloc(sizeof(*snapshot) + store->n_blocks * sizeof(blocks[0]));
+
+		if (!snapshot)
+			return NULL;
+	}
+
+	snapshot->store = store;
+	blocks = SNAPSHOT_BLOCKS_OF(snapshot);
+
+	for (b = 0; b < store->n_blocks; b++) {
+		tiles = &BOARD_AT(board, b * store->block_rows, 0);
+		span = snapshot_block_span(store, b);
+
+		if (parent) {
+			block = SNAPSHOT_BLOCKS_OF(parent)[b];
+
+			if (!memcmp(SNAPSHOT_BLOCK_TILES_OF(block), tiles, span)) {
+				block->refs++;
+				blocks[b] = block;
+				continue;
+			}
+		}
+
+		block = snapshot_block_alloc(store);
+
+		if (!block) {
+			/* Hands back what was taken so far */
+			for (; b < store->n_blocks; b++)
+				blocks[b] = NULL;
+
+			snapshot_release(snapshot);
+			return NULL;
+		}
+
+		memcpy(SNAPSHOT_BLOCK_TILES_OF(block), tiles, span);
+		blocks[b] = block;
+	}
+
+	return snapshot;
+}
+
+/* Rolls the tiles of a board back to a snapshot, writing only blocks that
+ * have changed since. Anything a board points to, e.g. a worklist, is left
+ * alone.
+ * */
+void snapshot_restore(const struct board_snapshot *snapshot, struct minesweeper_board *board)
+{
+	const struct snapshot_store *store = snapshot->store;
+	const unsigned char *saved;
+	unsigned char *tiles;
+	size_t span;
+	int b;
+
+	for (b = 0; b < store->n_blocks; b++) {
+		saved = SNAPSHOT_BLOCK_TILES_OF(SNAPSHOT_BLOCKS_OF(snapshot)[b]);
+		tiles = &BOARD_AT(board, b * store->block_rows, 0);
+		span = snapshot_block_span(store, b);
+
+		if (memcmp(tiles, saved, span))
+			memcpy(tiles, saved, span);
+	}
+}
+
+/* Blocks other snapshots still share stay around for them */
+void snapshot_release(struct board_snapshot *snapshot)
+{
+	struct snapshot_store *store;
+	struct snapshot_block *block;
+	int b;
+
+	if (!snapshot)
+		return;
+
+	store = snapshot->store;
+
+	for (b = 0; b < store->n_blocks; b++) {
+		block = SNAPSHOT_BLOCKS_OF(snapshot)[b];
+
+		if (!block || --block->refs)
+			continue;
+
+		block->next_free = store->free_blocks;
+		store->free_blocks = block;
+	}
+
+	snapshot->next_free = store->free_snapshots;
+	store->free_snapshots = snapshot;
+}
+
+static struct snapshot_block *snapshot_block_alloc(struct snapshot_store *store)
+{
+	struct snapshot_block *block;
+
+	if ((block = store->free_blocks)) {
+		store->free_blocks = block->next_free;
+	} else {
+		block = malloc(sizeof(*block) + snapshot_block_span(store, 0));
+
+		if (!block)
+			return NULL;
+	}
+
+	block->refs = 1;
+
+	return block;
+}
+
+/* Bytes from the first tile of a block to its last, the first block being
+ * the largest
+ * */
+static size_t snapshot_block_span(const struct snapshot_store *store, int block)
+{
+	int rows = store->rows - block * store->block_rows;
+
+	if (rows > store->block_rows)
+		rows = store->block_rows;
+
+	return (size_t)(rows - 1) * store->stride + store->cols;
+}
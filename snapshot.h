@@ -0,0 +1,37 @@
+#ifndef MINESWEEPER_SOLVER_SNAPSHOT_H
+#define MINESWEEPER_SOLVER_SNAPSHOT_H
+
+#include "board.h"
+
+struct snapshot_block;
+struct board_snapshot;
+
+/* Saved tiles of boards shaped like the one a store is set up with, for
+ * speculative search that tries something on a board and rolls it back. Rows
+ * are grouped into blocks, and a snapshot taken with a parent shares every
+ * block the board has not changed since the parent with it, so a branch only
+ * copies the blocks it touched. Boards themselves stay as they are, every
+ * rule works on them unchanged.
+ *
+ * Blocks and snapshots are recycled by the store. Every snapshot has to be
+ * released before the store is destroyed. A store is not thread safe.
+ * */
+struct snapshot_store {
+	int rows;
+	int cols;
+	int stride;
+	int block_rows;		/* Rows per block, the last may have fewer */
+	int n_blocks;
+	struct snapshot_block *free_blocks;
+	struct board_snapshot *free_snapshots;
+};
+
+void snapshot_store_init(struct snapshot_store *store, const struct minesweeper_board *board);
+void snapshot_store_destroy(struct snapshot_store *store);
+
+struct board_snapshot *snapshot_take(struct snapshot_store *store,
+		const struct minesweeper_board *board, const struct board_snapshot *parent);
+void snapshot_restore(const struct board_snapshot *snapshot, struct minesweeper_board *board);
+void snapshot_release(struct board_snapshot *snapshot);
+
+#endif /* MINESWEEPER_SOLVER_SNAPSHOT_H */
@@ -0,0 +1,105 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stddef.h>
+#include <time.h>
+
+#include "buf.h"
+#include "stats.h"
+
+#define STATS_COUNTER(__name) { #__name, offsetof(struct board_stats, __name) }
+
+/* The plain counters, in the order they are reported in */
+static const struct {
+	const char *name;
+	size_t offset;
+} stats_counters[] = {
+	STATS_COUNTER(boards),
+	STATS_COUNTER(tiles_scanned),
+	STATS_COUNTER(neighborhoods),
+	STATS_COUNTER(pairs),
+	STATS_COUNTER(windows),
+	STATS_COUNTER(window_cache_hits),
+	STATS_COUNTER(window_cache_misses),
+	STATS_COUNTER(layouts),
+	STATS_COUNTER(layouts_too_few),
+	STATS_COUNTER(layouts_too_many),
+	STATS_COUNTER(frontiers),
+	STATS_COUNTER(frontier_components),
+	STATS_COUNTER(frontier_cells),
+	STATS_COUNTER(steps),
+};
+
+#define STATS_N_COUNTERS	(sizeof(stats_counters) / sizeof(stats_counters[0]))
+
+static unsigned long *stats_counter(const struct board_stats *stats, size_t i);
+
+void board_stats_add(struct board_stats *sum, const struct board_stats *stats)
+{
+	size_t i;
+
+	for (i = 0; i < STATS_N_COUNTERS; i++)
+		*stats_counter(sum, i) += *stats_counter(stats, i);
+
+	for (i = 0; i < BOARD_N_STAGES; i++) {
+		sum->stages[i].invocations += stats->stages[i].invocations;
+		sum->stages[i].deductions += stats->stages[i].deductions;
+		sum->stages[i].ns += stats->stages[i].ns;
+	}
+
+	sum->read_ns += stats->read_ns;
+	sum->solve_ns += stats->solve_ns;
+	sum->write_ns += stats->write_ns;
+}
+
+/* One object, counters first, then stages by name and phases. Times are in
+ * nanoseconds.
+ * */
+int board_stats_to_json(const struct board_stats *stats, struct gr_buffer *out)
+{
+	const struct board_stage_stats *stage;
+	size_t i;
+
+	if (buf_printf(out, "{\n") < 0)
+		return 1;
+
+	for (i = 0; i < STATS_N_COUNTERS; i++)
+		if (buf_printf(out, "  \"%s\": %lu,\n", stats_counters[i].name,
+					*stats_counter(stats, i)) < 0)
+			return 1;
+
+	if (buf_printf(out, "  \"stages\": {\n") < 0)
+		return 1;
+
+	for (i = 0; i < BOARD_N_STAGES; i++) {
+		stage = &stats->stages[i];
+
+		if (buf_printf(out, "    \"%s\": {\"invocations\": %lu, \"deductions\": %lu, "
+					"\"ns\": %llu}%s\n",
+					board_stage_names[i], stage->invocations, stage->deductions,
+					(unsigned long long)stage->ns,
+					i + 1 < BOARD_N_STAGES ? "," : "") < 0)
+			return 1;
+	}
+
+	if (buf_printf(out, "  },\n  \"phases\": {\"read_ns\": %llu, \"solve_ns\": %llu, "
+				"\"write_ns\": %llu}\n}\n",
+				(unsigned long long)stats->read_ns,
+				(unsigned long long)stats->solve_ns,
+				(unsigned long long)stats->write_ns) < 0)
+		return 1;
+
+	return 0;
+}
+
+uint64_t board_stats_now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+static unsigned long *stats_counter(const struct board_stats *stats, size_t i)
+{
+	return (unsigned long *)((char *)stats + stats_counters[i].offset);
+}
@@ -0,0 +1,52 @@
+#ifndef MINESWEEPER_SOLVER_STATS_H
+#define MINESWEEPER_SOLVER_STATS_H
+
+#include <stdint.h>
+
+#include <gramas/buf.h>
+
+#include "board.h"
+
+struct board_stage_stats {
+	unsigned long invocations;
+	unsigned long deductions;	/* Tiles deduced */
+	uint64_t ns;			/* Time spent in the stage */
+};
+
+/* What the solver got up to, counted while board->stats is set. Every field
+ * is a plain sum, so the stats of separate runs can be added up.
+ * */
+struct board_stats {
+	unsigned long boards;
+	unsigned long tiles_scanned;	/* By rules going over the whole board */
+	unsigned long neighborhoods;	/* Times the neighbors of a tile were counted */
+	unsigned long pairs;		/* Pairs of numbers compared */
+	unsigned long windows;		/* Windows worked out, cached ones included */
+	unsigned long window_cache_hits;
+	unsigned long window_cache_misses;
+	unsigned long layouts;		/* Mine layouts tried by windows */
+	unsigned long layouts_too_few;	/* Rejected for leaving a number short */
+	unsigned long layouts_too_many;	/* Rejected for giving a number too many */
+	unsigned long frontiers;	/* Frontiers built */
+	unsigned long frontier_components;
+	unsigned long frontier_cells;
+	unsigned long steps;		/* Steps of full solves */
+
+	/* Deductions on partial boards by stage, full solves count theirs
+	 * under simple and frontier
+	 * */
+	struct board_stage_stats stages[BOARD_N_STAGES];
+
+	/* Wall time by phase */
+	uint64_t read_ns;
+	uint64_t solve_ns;
+	uint64_t write_ns;
+};
+
+void board_stats_add(struct board_stats *sum, const struct board_stats *stats);
+int board_stats_to_json(const struct board_stats *stats, struct gr_buffer *out);
+
+/* Monotonic clock all of the times above are taken with */
+uint64_t board_stats_now_ns(void);
+
+#endif /* MINESWEEPER_SOLVER_STATS_H */
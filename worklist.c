@@ -0,0 +1,68 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "worklist.h"
+
+int worklist_init(struct board_worklist *worklist, int rows, int cols)
+{
+	memset(worklist, 0, sizeof(*worklist));
+
+	worklist->rows = rows;
+	worklist->cols = cols;
+	worklist->queue = malloc(sizeof(worklist->queue[0]) * rows * cols);
+	worklist->queued = calloc(rows * cols, sizeof(worklist->queued[0]));
+	worklist->revealed = malloc(sizeof(worklist->revealed[0]) * rows * cols);
+
+	if (!worklist->queue || !worklist->queued || !worklist->revealed) {
+		worklist_destroy(worklist);
+		return 1;
+	}
+
+	return 0;
+}
+
+void worklist_destroy(struct board_worklist *worklist)
+{
+	free(worklist->queue);
+	free(worklist->queued);
+	free(worklist->revealed);
+
+	memset(worklist, 0, sizeof(*worklist));
+}
+
+void worklist_push(struct board_worklist *worklist, int row, int col)
+{
+	int idx;
+
+	idx = row * worklist->cols + col;
+
+	if (worklist->queued[idx])
+		return;
+
+	worklist->queued[idx] = 1;
+	worklist->queue[(worklist->head + worklist->length) % (worklist->rows * worklist->cols)] = idx;
+	worklist->length++;
+}
+
+int worklist_pop(struct board_worklist *worklist, int *row, int *col)
+{
+	int idx;
+
+	if (!worklist->length)
+		return 0;
+
+	idx = worklist->queue[worklist->head];
+	worklist->head = (worklist->head + 1) % (worklist->rows * worklist->cols);
+	worklist->length--;
+	worklist->queued[idx] = 0;
+
+	*row = idx / worklist->cols;
+	*col = idx % worklist->cols;
+
+	return 1;
+}
+
+void worklist_log_reveal(struct board_worklist *worklist, int row, int col)
+{
+	worklist->revealed[worklist->n_revealed++] = row * worklist->cols + col;
+}
@@ -0,0 +1,30 @@
+#ifndef MINESWEEPER_SOLVER_WORKLIST_H
+#define MINESWEEPER_SOLVER_WORKLIST_H
+
+/* FIFO of tiles whose neighborhood changed since they were last looked at.
+ * A tile sits in the queue at most once, so a ring of rows * cols entries
+ * never overflows.
+ * */
+struct board_worklist {
+	int rows;
+	int cols;
+	int head;
+	int length;
+	int *queue;
+	unsigned char *queued;
+
+	/* Tiles revealed during the current step of a full solve. They become
+	 * known, and thus useful, only once the step is over. When deducing on
+	 * a partial board, tiles deduced so far.
+	 * */
+	int n_revealed;
+	int *revealed;
+};
+
+int worklist_init(struct board_worklist *worklist, int rows, int cols);
+void worklist_destroy(struct board_worklist *worklist);
+void worklist_push(struct board_worklist *worklist, int row, int col);
+int worklist_pop(struct board_worklist *worklist, int *row, int *col);
+void worklist_log_reveal(struct board_worklist *worklist, int row, int col);
+
+#endif /* MINESWEEPER_SOLVER_WORKLIST_H */